@@ -10,29 +10,35 @@
 #include <libwebsockets.h>
 #include <cstring>
 #include <chrono>
+#include "deflatepolicy.hpp"
+#include "pagearchive.hpp"
 
 using json = nlohmann::json;
 using tcp = boost::asio::ip::tcp;
 namespace http = boost::beast::http;
 
 std::string WS_URL_PATH = "";
+std::string CDP_HOST = "localhost";
 static struct lws_context *context;
 static struct lws *wsi_client = nullptr;
 static std::string received_payload;
 static int send_counter = 1;
 static bool dom_received = false;
 static bool command_sent = false;
+static DeflatePolicy deflate_policy;
+static std::string PAGE_URL;
+static PageArchive *page_archive = nullptr;
 
 std::string get_websocket_url_from_chrome() {
     boost::asio::io_context ioc;
     tcp::resolver resolver(ioc);
     boost::beast::tcp_stream stream(ioc);
 
-    auto const results = resolver.resolve("localhost", "9222");
+    auto const results = resolver.resolve(CDP_HOST, "9222");
     stream.connect(results);
 
     http::request<http::string_body> req{http::verb::get, "/json", 11};
-    req.set(http::field::host, "localhost");
+    req.set(http::field::host, CDP_HOST);
     req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
     http::write(stream, req);
 
@@ -43,6 +49,7 @@ std::string get_websocket_url_from_chrome() {
 
     json j = json::parse(res.body());
     std::string ws_url = j[0]["webSocketDebuggerUrl"];
+    PAGE_URL = j[0].value("url", "");
     return ws_url;
 }
 
@@ -90,9 +97,7 @@ static int callback_cdp(struct lws *wsi, enum lws_callback_reasons reason,
                     std::string html = j["result"]["result"]["value"];
                     std::cout << "📜 Full Dynamic HTML:\n" << html << "\n";
 
-                    std::ofstream file("extracted_dom.html");
-                    file << html;
-                    file.close();
+                    save_capture(page_archive, PAGE_URL, "extracted_dom.html", html);
 
                     dom_received = true;
                     lws_cancel_service(context);
@@ -134,10 +139,21 @@ static struct lws_protocols protocols[] = {
     { nullptr, nullptr, 0, 0, 0, nullptr, 0 }
 };
 
+// outerHTML comes back as one multi-megabyte message; compress it when
+// Chrome is remote.
+static const struct lws_extension extensions[] = {
+    { "permessage-deflate", lws_extension_callback_pm_deflate, "permessage-deflate; client_max_window_bits" },
+    { nullptr, nullptr, nullptr }
+};
+
 void run_websocket() {
     struct lws_context_creation_info info = {};
     info.port = CONTEXT_PORT_NO_LISTEN;
     info.protocols = protocols;
+    if (deflate_policy.negotiate(CDP_HOST)) {
+        info.extensions = extensions;
+        std::cout << "🗜 Offering permessage-deflate to " << CDP_HOST << "\n";
+    }
 
     context = lws_create_context(&info);
     if (!context) {
@@ -147,7 +163,7 @@ void run_websocket() {
 
     struct lws_client_connect_info ccinfo = {};
     ccinfo.context = context;
-    ccinfo.address = "localhost";
+    ccinfo.address = CDP_HOST.c_str();
     ccinfo.port = 9222;
     ccinfo.path = WS_URL_PATH.c_str();
     ccinfo.host = lws_canonical_hostname(context);
@@ -174,7 +190,15 @@ void run_websocket() {
     lws_context_destroy(context);
 }
 
-int main() {
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--host" && i + 1 < argc) CDP_HOST = argv[++i];
+        else if (arg == "--no-deflate") deflate_policy.enabled = false;
+        else if (arg == "--deflate-loopback") deflate_policy.on_loopback = true;
+        else if (arg == "--archive" && i + 1 < argc) page_archive = new PageArchive(argv[++i]);
+    }
+
     std::cout << "🔍 Fetching WebSocket URL from Chrome...\n";
 
     std::string ws_url = get_websocket_url_from_chrome();
@@ -196,6 +220,11 @@ int main() {
 
     std::cout << "🚀 Starting WebSocket connection...\n";
     run_websocket();
+    if (page_archive) {
+        page_archive->close();
+        page_archive->print_stats(std::cout);
+        delete page_archive;
+    }
 
     std::cout << "✅ Done.\n";
     return 0;
@@ -0,0 +1,369 @@
+// cdpparse.hpp
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <deque>
+#include <cstring>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+
+// Arena parsing mode for large CDP messages (DOM.getDocument depth -1,
+// getFlattenedDocument, outerHTML). nlohmann::json allocates every node and
+// every string on the heap; here nlohmann's SAX lexer feeds a builder that
+// places the whole message in one bump arena:
+//
+//   CdpArenaParser parser;
+//   const CdpValue *msg = parser.parse(received_payload);
+//   for (const CdpValue &node : (*msg)["result"]["nodes"]) node.value("nodeId", 0);
+//
+// Values are read-only views into the arena and stay valid until the next
+// parse() on the same parser, which releases the previous message in one
+// shot and reuses its blocks. Object keys and short strings (tag names,
+// attribute names, "#text", ...) are interned in the parser, so they are
+// stored once no matter how many nodes repeat them.
+//
+// CdpValue mirrors the part of the nlohmann::json read API the clients use
+// (contains, operator[], value, get, size, range-for), so code such as
+// DomMirror::build works on either.
+class CdpValue {
+public:
+    enum class Type : uint8_t { Null, Bool, Int, Float, String, Array, Object };
+
+    Type type() const { return type_; }
+    bool is_null() const { return type_ == Type::Null; }
+    bool is_object() const { return type_ == Type::Object; }
+    bool is_array() const { return type_ == Type::Array; }
+    bool is_string() const { return type_ == Type::String; }
+    bool is_number() const { return type_ == Type::Int || type_ == Type::Float; }
+
+    size_t size() const { return (type_ == Type::Array || type_ == Type::Object) ? count_ : 0; }
+    bool empty() const { return size() == 0; }
+
+    // Range-for walks array elements, or object member values like nlohmann.
+    const CdpValue *begin() const { return size() ? items_ : nullptr; }
+    const CdpValue *end() const { return size() ? items_ + count_ : nullptr; }
+
+    std::string_view key_at(size_t i) const { return keys_[i]; }
+
+    const CdpValue *find(std::string_view key) const {
+        if (type_ != Type::Object) return nullptr;
+        for (uint32_t i = 0; i < count_; i++) {
+            if (keys_[i].size() == key.size() && std::memcmp(keys_[i].data(), key.data(), key.size()) == 0) {
+                return &items_[i];
+            }
+        }
+        return nullptr;
+    }
+
+    bool contains(std::string_view key) const { return find(key) != nullptr; }
+
+    const CdpValue &operator[](std::string_view key) const {
+        const CdpValue *v = find(key);
+        return v ? *v : null_value();
+    }
+    const CdpValue &operator[](const char *key) const { return (*this)[std::string_view(key)]; }
+    const CdpValue &operator[](size_t i) const { return i < size() ? items_[i] : null_value(); }
+    const CdpValue &operator[](int i) const { return (*this)[static_cast<size_t>(i)]; }
+
+    std::string_view as_string_view() const {
+        return type_ == Type::String ? std::string_view(str_, count_) : std::string_view();
+    }
+    int64_t as_int() const {
+        return type_ == Type::Int ? int_ : type_ == Type::Float ? static_cast<int64_t>(float_) : 0;
+    }
+    double as_double() const { return type_ == Type::Float ? float_ : static_cast<double>(as_int()); }
+    bool as_bool() const { return type_ == Type::Bool && bool_; }
+
+    template <typename T>
+    T get() const {
+        if constexpr (std::is_same_v<T, std::string>) {
+            return std::string(as_string_view());
+        } else if constexpr (std::is_same_v<T, std::string_view>) {
+            return as_string_view();
+        } else if constexpr (std::is_same_v<T, bool>) {
+            return as_bool();
+        } else if constexpr (std::is_floating_point_v<T>) {
+            return static_cast<T>(as_double());
+        } else {
+            return static_cast<T>(as_int());
+        }
+    }
+
+    template <typename T>
+    T value(std::string_view key, T fallback) const {
+        const CdpValue *v = find(key);
+        if (!v || v->is_null()) return fallback;
+        return v->get<T>();
+    }
+    std::string value(std::string_view key, const char *fallback) const {
+        const CdpValue *v = find(key);
+        return (v && v->is_string()) ? std::string(v->as_string_view()) : std::string(fallback);
+    }
+
+    // Converts back to a nlohmann::json tree for code that still needs one.
+    nlohmann::json to_json() const {
+        switch (type_) {
+            case Type::Bool: return bool_;
+            case Type::Int: return int_;
+            case Type::Float: return float_;
+            case Type::String: return std::string(as_string_view());
+            case Type::Array: {
+                nlohmann::json arr = nlohmann::json::array();
+                for (const auto &item : *this) arr.push_back(item.to_json());
+                return arr;
+            }
+            case Type::Object: {
+                nlohmann::json obj = nlohmann::json::object();
+                for (uint32_t i = 0; i < count_; i++) obj[std::string(keys_[i])] = items_[i].to_json();
+                return obj;
+            }
+            default: return nullptr;
+        }
+    }
+
+private:
+    friend class CdpArenaParser;
+
+    Type type_ = Type::Null;
+    uint32_t count_ = 0;  // string length or number of elements
+    union {
+        bool bool_;
+        int64_t int_;
+        double float_;
+        const char *str_;
+        const CdpValue *items_;
+    };
+    const std::string_view *keys_ = nullptr;
+
+    static const CdpValue &null_value() {
+        static const CdpValue null;
+        return null;
+    }
+
+public:
+    CdpValue() : int_(0) {}
+};
+
+class CdpArenaParser {
+public:
+    explicit CdpArenaParser(size_t block_size = 1 << 20) : block_size_(block_size) {
+        // Keys every CDP message repeats; interned up front so they never
+        // touch the arena.
+        for (const char *key : {"id", "method", "params", "result", "sessionId", "error", "message",
+                                "nodeId", "backendNodeId", "parentId", "nodeType", "nodeName", "localName",
+                                "nodeValue", "attributes", "children", "childNodeCount", "shadowRoots",
+                                "contentDocument", "frameId", "documentURL", "baseURL", "root", "nodes",
+                                "value", "type", "requestId", "url", "pseudoElements", "#text", "#document"}) {
+            intern(key);
+        }
+    }
+
+    // Parse one complete message. Returns nullptr on malformed input. The
+    // result is valid until the next call to parse().
+    const CdpValue *parse(std::string_view text) {
+        reset_arena();
+        // Each value is a 24-byte CdpValue; a DOM dump comes out at about
+        // three times its text size.
+        reserve_arena(text.size() * 3);
+        values_.clear();
+        keys_.clear();
+        frames_.clear();
+
+        Builder builder{*this};
+        bool ok = nlohmann::json::sax_parse(text.begin(), text.end(), &builder);
+        if (!ok || values_.size() != 1) return nullptr;
+        CdpValue *root = alloc<CdpValue>(1);
+        *root = values_.back();
+        return root;
+    }
+
+    size_t arena_bytes_used() const { return used_total(); }
+    size_t block_allocations() const { return block_allocations_; }
+    size_t interned_strings() const { return interned_.size(); }
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    struct Frame {
+        size_t first_value;
+        size_t first_key;
+        bool object;
+    };
+
+    // Short strings worth interning: tag names, attribute names, enum-like values.
+    static constexpr size_t kInternMax = 24;
+    static constexpr size_t kInternCap = 1 << 14;
+
+    size_t block_size_;
+    std::vector<Block> blocks_;
+    size_t block_index_ = 0;
+    size_t offset_ = 0;
+    size_t block_allocations_ = 0;
+
+    // Build stacks, reused across messages.
+    std::vector<CdpValue> values_;
+    std::vector<std::string_view> keys_;
+    std::vector<Frame> frames_;
+
+    std::deque<std::string> intern_storage_;
+    std::unordered_map<std::string_view, std::string_view> interned_;
+
+    void reset_arena() {
+        block_index_ = 0;
+        offset_ = 0;
+    }
+
+    void reserve_arena(size_t bytes) {
+        if (!blocks_.empty() && blocks_[0].size >= bytes) return;
+        // Replace the first block with one large enough for the whole message
+        // so steady-state parses allocate nothing.
+        size_t size = std::max(block_size_, bytes);
+        if (blocks_.empty()) {
+            blocks_.push_back({std::unique_ptr<char[]>(new char[size]), size});
+        } else {
+            blocks_[0] = {std::unique_ptr<char[]>(new char[size]), size};
+        }
+        block_allocations_++;
+    }
+
+    size_t used_total() const {
+        size_t total = offset_;
+        for (size_t i = 0; i < block_index_ && i < blocks_.size(); i++) total += blocks_[i].size;
+        return total;
+    }
+
+    void *alloc_bytes(size_t bytes, size_t align) {
+        while (true) {
+            if (block_index_ < blocks_.size()) {
+                size_t aligned = (offset_ + align - 1) & ~(align - 1);
+                if (aligned + bytes <= blocks_[block_index_].size) {
+                    offset_ = aligned + bytes;
+                    return blocks_[block_index_].data.get() + aligned;
+                }
+                block_index_++;
+                offset_ = 0;
+                continue;
+            }
+            size_t size = std::max(block_size_, bytes + align);
+            blocks_.push_back({std::unique_ptr<char[]>(new char[size]), size});
+            block_allocations_++;
+        }
+    }
+
+    template <typename T>
+    T *alloc(size_t n) {
+        return static_cast<T *>(alloc_bytes(sizeof(T) * n, alignof(T)));
+    }
+
+    std::string_view intern(std::string_view s) {
+        auto it = interned_.find(s);
+        if (it != interned_.end()) return it->second;
+        intern_storage_.emplace_back(s);
+        std::string_view stored = intern_storage_.back();
+        interned_.emplace(stored, stored);
+        return stored;
+    }
+
+    std::string_view store_string(const std::string &s) {
+        if (s.size() <= kInternMax) {
+            auto it = interned_.find(s);
+            if (it != interned_.end()) return it->second;
+            if (interned_.size() < kInternCap) return intern(s);
+        }
+        char *p = alloc<char>(s.size());
+        std::memcpy(p, s.data(), s.size());
+        return std::string_view(p, s.size());
+    }
+
+    void push_scalar(CdpValue v) { values_.push_back(v); }
+
+    void close_container() {
+        Frame frame = frames_.back();
+        frames_.pop_back();
+        size_t n = values_.size() - frame.first_value;
+
+        CdpValue container;
+        container.type_ = frame.object ? CdpValue::Type::Object : CdpValue::Type::Array;
+        container.count_ = static_cast<uint32_t>(n);
+        CdpValue *items = alloc<CdpValue>(n);
+        std::copy(values_.begin() + frame.first_value, values_.end(), items);
+        container.items_ = items;
+        if (frame.object) {
+            std::string_view *keys = alloc<std::string_view>(n);
+            std::copy(keys_.begin() + frame.first_key, keys_.end(), keys);
+            container.keys_ = keys;
+            keys_.resize(frame.first_key);
+        }
+        values_.resize(frame.first_value);
+        values_.push_back(container);
+    }
+
+    struct Builder {
+        CdpArenaParser &p;
+
+        bool null() {
+            p.push_scalar(CdpValue());
+            return true;
+        }
+        bool boolean(bool b) {
+            CdpValue v;
+            v.type_ = CdpValue::Type::Bool;
+            v.bool_ = b;
+            p.push_scalar(v);
+            return true;
+        }
+        bool number_integer(int64_t i) {
+            CdpValue v;
+            v.type_ = CdpValue::Type::Int;
+            v.int_ = i;
+            p.push_scalar(v);
+            return true;
+        }
+        bool number_unsigned(uint64_t u) { return number_integer(static_cast<int64_t>(u)); }
+        bool number_float(double d, const std::string &) {
+            CdpValue v;
+            v.type_ = CdpValue::Type::Float;
+            v.float_ = d;
+            p.push_scalar(v);
+            return true;
+        }
+        bool string(std::string &s) {
+            std::string_view stored = p.store_string(s);
+            CdpValue v;
+            v.type_ = CdpValue::Type::String;
+            v.str_ = stored.data();
+            v.count_ = static_cast<uint32_t>(stored.size());
+            p.push_scalar(v);
+            return true;
+        }
+        bool binary(nlohmann::json::binary_t &) { return false; }
+        bool start_object(size_t) {
+            p.frames_.push_back({p.values_.size(), p.keys_.size(), true});
+            return true;
+        }
+        bool key(std::string &k) {
+            p.keys_.push_back(p.store_string(k));
+            return true;
+        }
+        bool end_object() {
+            p.close_container();
+            return true;
+        }
+        bool start_array(size_t) {
+            p.frames_.push_back({p.values_.size(), p.keys_.size(), false});
+            return true;
+        }
+        bool end_array() {
+            p.close_container();
+            return true;
+        }
+        bool parse_error(size_t, const std::string &, const nlohmann::detail::exception &) { return false; }
+    };
+};
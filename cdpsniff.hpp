@@ -0,0 +1,118 @@
+// cdpsniff.hpp
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <map>
+#include <functional>
+#include <charconv>
+#include <ostream>
+#include <nlohmann/json.hpp>
+
+// The session a CDP message belongs to, without parsing it. Chrome writes
+// sessionId as the last top-level member of flattened-session messages
+// (...,"sessionId":"8F2A..."}), so only the tail is looked at; messages of the
+// browser or a page connection have none and return "".
+inline std::string_view cdp_session_key(std::string_view message) {
+    static constexpr std::string_view tag = "\"sessionId\":\"";
+    size_t end = message.find_last_not_of(" \t\r\n");
+    if (end == std::string_view::npos || end < tag.size() + 2 || message[end] != '}' || message[end - 1] != '"')
+        return {};
+    size_t open = message.rfind('"', end - 2);
+    if (open == std::string_view::npos || open + 1 < tag.size()) return {};
+    if (message.substr(open + 1 - tag.size(), tag.size()) != tag) return {};
+    return message.substr(open + 1, end - 1 - (open + 1));
+}
+
+// What a CDP message is, read from its first member and its tail. Chrome
+// starts replies with "id" and events with "method", so this costs a few
+// compares however large the message is. When the prefix is not in that form
+// (hand-written or reformatted JSON) ok is false and the caller parses.
+struct CdpEnvelope {
+    bool ok = false;
+    int id = -1;                // replies
+    std::string_view method;    // events
+    std::string_view session;
+
+    bool is_event() const { return ok && id < 0; }
+    bool is_reply() const { return ok && id >= 0; }
+};
+
+inline CdpEnvelope sniff_cdp_envelope(std::string_view message) {
+    static constexpr std::string_view id_key = "\"id\":";
+    static constexpr std::string_view method_key = "\"method\":\"";
+    CdpEnvelope envelope;
+    size_t start = message.find_first_not_of(" \t\r\n");
+    if (start == std::string_view::npos || message[start] != '{') return envelope;
+    std::string_view rest = message.substr(start + 1);
+
+    if (rest.substr(0, id_key.size()) == id_key) {
+        const char *first = rest.data() + id_key.size();
+        auto [ptr, ec] = std::from_chars(first, rest.data() + rest.size(), envelope.id);
+        if (ec != std::errc() || ptr == first || envelope.id < 0 || (*ptr != ',' && *ptr != '}')) {
+            envelope.id = -1;
+            return envelope;
+        }
+    } else if (rest.substr(0, method_key.size()) == method_key) {
+        size_t close = rest.find('"', method_key.size());
+        if (close == std::string_view::npos) return envelope;
+        envelope.method = rest.substr(method_key.size(), close - method_key.size());
+    } else {
+        return envelope;
+    }
+    envelope.ok = true;
+    envelope.session = cdp_session_key(message);
+    return envelope;
+}
+
+// Subscription table for events. Domains report far more than a client
+// looks at (Runtime.consoleAPICalled, DOM.* mutations, ...); events without a
+// handler are dropped on the sniffed method name and never parsed, the rest
+// are parsed once and handed to their handler, which may move out of it.
+//
+//   events.on("Page.loadEventFired", [](json &msg) { ... });
+//   CdpEnvelope env = sniff_cdp_envelope(text);
+//   if (env.is_event()) { events.route(env, text); return; }
+class CdpEventRouter {
+public:
+    using Handler = std::function<void(nlohmann::json &message)>;
+
+    void on(std::string method, Handler handler) { handlers_[std::move(method)] = std::move(handler); }
+
+    bool wants(std::string_view method) const { return handlers_.find(method) != handlers_.end(); }
+
+    // A sniffed event.
+    void route(const CdpEnvelope &envelope, std::string_view message) {
+        auto it = handlers_.find(envelope.method);
+        if (it == handlers_.end()) {
+            skip(message.size());
+            return;
+        }
+        routed_++;
+        nlohmann::json parsed = nlohmann::json::parse(message);
+        it->second(parsed);
+    }
+
+    // An event that had to be parsed to be recognised.
+    void route(nlohmann::json &message) {
+        auto it = handlers_.find(message.value("method", ""));
+        if (it == handlers_.end()) return;
+        routed_++;
+        it->second(message);
+    }
+
+    // Counts a message the caller discarded unparsed (e.g. a reply nobody waits for).
+    void skip(size_t bytes) {
+        dropped_++;
+        dropped_bytes_ += bytes;
+    }
+
+    void print_stats(std::ostream &out) const {
+        out << "CDP messages: " << routed_ << " events handled, " << dropped_ << " dropped unparsed (" << dropped_bytes_ / 1024
+            << " KiB)\n";
+    }
+
+private:
+    std::map<std::string, Handler, std::less<>> handlers_;
+    size_t routed_ = 0, dropped_ = 0, dropped_bytes_ = 0;
+};
@@ -0,0 +1,178 @@
+// cmdscheduler.hpp
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <deque>
+#include <map>
+#include <set>
+#include <chrono>
+#include <ostream>
+#include <algorithm>
+
+// Send-side priority classes for CDP commands. One connection carries
+// everything the client does, so a multi-megabyte extraction queued just
+// before a keystroke would otherwise delay it by its whole transfer.
+enum class CdpPriority { Interactive, Navigation, Bulk, Telemetry };
+
+inline const char *cdp_priority_name(CdpPriority priority) {
+    static const char *const names[] = {"interactive", "navigation", "bulk", "telemetry"};
+    return names[static_cast<int>(priority)];
+}
+
+// Input and the DOM steps of a click or keystroke are interactive, and so
+// are screencast frame acks: Chrome sends no further frame until the last
+// one is acked. Commands whose replies are large (documents, snapshots,
+// PDFs, screenshots, bodies) are bulk; metrics and logs are telemetry.
+// Everything else, including navigation, Fetch continuations and domain
+// enables, is Navigation.
+inline CdpPriority cdp_priority(std::string_view method) {
+    auto starts = [&](std::string_view prefix) { return method.substr(0, prefix.size()) == prefix; };
+    if (starts("Input.") || method == "DOM.focus" || method == "DOM.scrollIntoViewIfNeeded" ||
+        method == "DOM.getContentQuads" || method == "DOM.getBoxModel" || method == "Page.screencastFrameAck")
+        return CdpPriority::Interactive;
+    if (method == "DOM.getDocument" || method == "DOM.getFlattenedDocument" || method == "DOM.getOuterHTML" ||
+        starts("DOMSnapshot.") || method == "Page.printToPDF" || method == "Page.captureScreenshot" ||
+        method == "Page.captureSnapshot" || starts("IO.") || method == "Fetch.getResponseBody" ||
+        method == "Network.getResponseBody" || method == "Accessibility.getFullAXTree")
+        return CdpPriority::Bulk;
+    if (starts("Performance.") || starts("Log.") || starts("Tracing."))
+        return CdpPriority::Telemetry;
+    return CdpPriority::Navigation;
+}
+
+struct ScheduledCommand {
+    int id = 0;
+    std::string session;       // "" for the page/browser connection itself
+    CdpPriority priority = CdpPriority::Navigation;
+    std::string text;          // the serialized command
+};
+
+// Orders queued commands for the socket, on the thread that writes them:
+//
+//   - classes go strictly in priority order, except that a Bulk or Telemetry
+//     command waiting longer than starvation_limit goes next;
+//   - within a class, sessions take turns one command at a time, so a tab
+//     with a long queue does not hold up another tab's commands;
+//   - at most max_bulk_in_flight Bulk commands are sent and unanswered at a
+//     time; the rest wait for on_reply(), so large replies cannot pile up
+//     in front of interactive ones on the way back either.
+//
+// Commands of one session and class stay in order. Commands of different
+// classes may overtake each other, so a caller that needs one to run before
+// another (in a different class) must wait for its reply, as the reply-driven
+// state machines already do.
+class CommandScheduler {
+public:
+    struct Options {
+        size_t max_bulk_in_flight = 2;
+        std::chrono::milliseconds starvation_limit{250};
+    };
+
+    CommandScheduler() : CommandScheduler(Options()) {}
+    explicit CommandScheduler(Options options) : options_(options) {}
+
+    void push(ScheduledCommand command) {
+        Lane &lane = lanes_[static_cast<int>(command.priority)];
+        auto &queue = lane.sessions[command.session];
+        if (queue.empty()) lane.turns.push_back(command.session);
+        queue.push_back({std::move(command), Clock::now()});
+        queued_++;
+    }
+
+    // The next command to write, or false when nothing may be sent now.
+    bool pop(ScheduledCommand &out) {
+        int lane = pick();
+        if (lane < 0) return false;
+        Lane &l = lanes_[lane];
+        std::string session = std::move(l.turns.front());
+        l.turns.pop_front();
+        auto it = l.sessions.find(session);
+        Entry entry = std::move(it->second.front());
+        it->second.pop_front();
+        if (it->second.empty()) {
+            l.sessions.erase(it);
+        } else {
+            l.turns.push_back(std::move(session));
+        }
+        queued_--;
+
+        auto waited = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - entry.queued_at);
+        Stats &stats = stats_[lane];
+        stats.sent++;
+        stats.total_wait += waited;
+        stats.max_wait = std::max(stats.max_wait, waited);
+        if (entry.command.priority == CdpPriority::Bulk) bulk_in_flight_.insert(entry.command.id);
+        out = std::move(entry.command);
+        return true;
+    }
+
+    // Feed the id of every reply; returns true if it let a held Bulk command go.
+    bool on_reply(int id) {
+        if (!bulk_in_flight_.erase(id)) return false;
+        return !lanes_[static_cast<int>(CdpPriority::Bulk)].turns.empty();
+    }
+
+    // Something can be sent now.
+    bool ready() const { return pick() >= 0; }
+    bool empty() const { return queued_ == 0; }
+    size_t size() const { return queued_; }
+
+    void print_stats(std::ostream &out) const {
+        out << "send scheduler:";
+        for (int i = 0; i < lanes; i++) {
+            const Stats &s = stats_[i];
+            if (!s.sent) continue;
+            out << " " << cdp_priority_name(static_cast<CdpPriority>(i)) << " " << s.sent << " sent (avg wait "
+                << s.total_wait.count() / s.sent / 1000.0 << " ms, max " << s.max_wait.count() / 1000.0 << " ms);";
+        }
+        out << "\n";
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    static constexpr int lanes = 4;
+
+    struct Entry {
+        ScheduledCommand command;
+        Clock::time_point queued_at;
+    };
+
+    struct Lane {
+        std::map<std::string, std::deque<Entry>> sessions;
+        std::deque<std::string> turns;  // sessions with commands, next first
+    };
+
+    struct Stats {
+        size_t sent = 0;
+        std::chrono::microseconds total_wait{0}, max_wait{0};
+    };
+
+    Options options_;
+    Lane lanes_[lanes];
+    Stats stats_[lanes];
+    std::set<int> bulk_in_flight_;
+    size_t queued_ = 0;
+
+    bool may_send(int lane) const {
+        if (lanes_[lane].turns.empty()) return false;
+        return lane != static_cast<int>(CdpPriority::Bulk) || bulk_in_flight_.size() < options_.max_bulk_in_flight;
+    }
+
+    bool starving(int lane) const {
+        const Lane &l = lanes_[lane];
+        const Entry &next = l.sessions.at(l.turns.front()).front();
+        return Clock::now() - next.queued_at > options_.starvation_limit;
+    }
+
+    int pick() const {
+        for (CdpPriority p : {CdpPriority::Bulk, CdpPriority::Telemetry}) {
+            int lane = static_cast<int>(p);
+            if (may_send(lane) && starving(lane)) return lane;
+        }
+        for (int lane = 0; lane < lanes; lane++) {
+            if (may_send(lane)) return lane;
+        }
+        return -1;
+    }
+};
@@ -0,0 +1,129 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <zlib.h>
+
+// Bytes-on-wire versus CPU for permessage-deflate on CDP payloads.
+//
+//   deflatebench [--level 6] [--mbit 100] [file ...]
+//
+// Each file is a saved CDP message (e.g. a getFlattenedDocument reply); with
+// no files a synthetic flattened document is used. Every payload is cut to a
+// range of prefix sizes and compressed with raw deflate (window bits 15, as
+// permessage-deflate uses). The table shows ratio, compress and inflate cost,
+// and the end-to-end time with and without compression at --mbit. The
+// smallest size where compression wins is a sensible
+// DeflatePolicy::min_message_size for that link.
+
+using steady = std::chrono::steady_clock;
+
+struct Measurement {
+    size_t size = 0;
+    size_t compressed = 0;
+    double deflate_us = 0;
+    double inflate_us = 0;
+};
+
+std::string synthetic_document(size_t nodes) {
+    std::ostringstream out;
+    out << "{\"id\":4,\"result\":{\"nodes\":[";
+    for (size_t i = 0; i < nodes; i++) {
+        if (i) out << ",";
+        out << "{\"nodeId\":" << i + 1 << ",\"parentId\":" << i / 4 << ",\"backendNodeId\":" << i + 7
+            << ",\"nodeType\":1,\"nodeName\":\"" << (i % 3 ? "DIV" : "A") << "\",\"localName\":\""
+            << (i % 3 ? "div" : "a") << "\",\"nodeValue\":\"\",\"childNodeCount\":" << i % 5
+            << ",\"attributes\":[\"class\",\"item item-" << i % 17 << "\",\"href\",\"/p/" << i << "\"]}";
+    }
+    out << "]}}";
+    return out.str();
+}
+
+Measurement measure(const std::string &payload, size_t size, int level, int rounds) {
+    Measurement m;
+    m.size = size;
+    std::vector<unsigned char> compressed(compressBound(size) + 64);
+    std::vector<unsigned char> inflated(size + 64);
+
+    for (int r = 0; r < rounds; r++) {
+        z_stream zs = {};
+        deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+        auto start = steady::now();
+        zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(payload.data()));
+        zs.avail_in = static_cast<uInt>(size);
+        zs.next_out = compressed.data();
+        zs.avail_out = static_cast<uInt>(compressed.size());
+        // Sync flush per message, as permessage-deflate does.
+        deflate(&zs, Z_SYNC_FLUSH);
+        m.deflate_us += std::chrono::duration<double, std::micro>(steady::now() - start).count();
+        m.compressed = zs.total_out;
+        deflateEnd(&zs);
+
+        z_stream is = {};
+        inflateInit2(&is, -15);
+        start = steady::now();
+        is.next_in = compressed.data();
+        is.avail_in = static_cast<uInt>(m.compressed);
+        is.next_out = inflated.data();
+        is.avail_out = static_cast<uInt>(inflated.size());
+        inflate(&is, Z_SYNC_FLUSH);
+        m.inflate_us += std::chrono::duration<double, std::micro>(steady::now() - start).count();
+        inflateEnd(&is);
+    }
+    m.deflate_us /= rounds;
+    m.inflate_us /= rounds;
+    return m;
+}
+
+int main(int argc, char **argv) {
+    int level = 6;
+    double mbit = 100;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--level" && i + 1 < argc) level = std::atoi(argv[++i]);
+        else if (arg == "--mbit" && i + 1 < argc) mbit = std::atof(argv[++i]);
+        else files.push_back(arg);
+    }
+
+    std::vector<std::pair<std::string, std::string>> payloads;
+    for (const auto &path : files) {
+        std::ifstream in(path, std::ios::binary);
+        std::ostringstream ss;
+        ss << in.rdbuf();
+        if (!ss.str().empty()) payloads.push_back({path, ss.str()});
+    }
+    if (payloads.empty()) payloads.push_back({"synthetic", synthetic_document(50000)});
+
+    double bytes_per_us = mbit * 1e6 / 8 / 1e6;
+    std::printf("link %.0f Mbit/s, deflate level %d\n", mbit, level);
+    for (const auto &[name, payload] : payloads) {
+        std::printf("\n%s (%zu bytes)\n", name.c_str(), payload.size());
+        std::printf("%10s %10s %7s %12s %12s %12s %12s\n", "size", "wire", "ratio", "deflate(us)", "inflate(us)",
+                    "plain(us)", "deflated(us)");
+        size_t break_even = 0;
+        for (size_t size = 256; ; size *= 4) {
+            size = std::min(size, payload.size());
+            int rounds = size < 65536 ? 200 : 10;
+            Measurement m = measure(payload, size, level, rounds);
+            double plain = m.size / bytes_per_us;
+            double deflated = m.compressed / bytes_per_us + m.deflate_us + m.inflate_us;
+            if (!break_even && deflated < plain) break_even = size;
+            std::printf("%10zu %10zu %6.1fx %12.1f %12.1f %12.1f %12.1f\n", m.size, m.compressed,
+                        static_cast<double>(m.size) / std::max<size_t>(1, m.compressed), m.deflate_us, m.inflate_us,
+                        plain, deflated);
+            if (size == payload.size()) break;
+        }
+        if (break_even) {
+            std::printf("compression wins from ~%zu bytes at %.0f Mbit/s\n", break_even, mbit);
+        } else {
+            std::printf("compression never wins at %.0f Mbit/s\n", mbit);
+        }
+    }
+    return 0;
+}
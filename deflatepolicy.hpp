@@ -0,0 +1,33 @@
+// deflatepolicy.hpp
+
+#pragma once
+#include <string>
+#include <cstddef>
+
+// When to use permessage-deflate (RFC 7692) on the CDP WebSocket.
+//
+// getFlattenedDocument / outerHTML replies are megabytes of JSON that deflate
+// 10-20x, which matters when Chrome runs on another machine. Over loopback
+// the link is faster than zlib, so compression only costs CPU; that is the
+// default for localhost. Chrome decides per message whether to compress its
+// replies once the extension is negotiated, so the policy only decides
+// whether to offer the extension. deflatebench.cpp measures where the
+// break-even point lies for a link.
+struct DeflatePolicy {
+    bool enabled = true;
+    bool on_loopback = false;
+    // Beast transport only, and only when built against Boost 1.77 or later
+    // (msg_size_threshold): outbound messages below this go uncompressed.
+    // libwebsockets has no per-message switch, so the lws clients ignore it.
+    size_t min_message_size = 4096;
+
+    bool negotiate(const std::string &host) const;
+};
+
+inline bool is_loopback_host(const std::string &host) {
+    return host == "localhost" || host == "::1" || host == "[::1]" || host.rfind("127.", 0) == 0;
+}
+
+inline bool DeflatePolicy::negotiate(const std::string &host) const {
+    return enabled && (on_loopback || !is_loopback_host(host));
+}
@@ -0,0 +1,175 @@
+// directclick.hpp
+
+#pragma once
+#include <string>
+#include <functional>
+#include <nlohmann/json.hpp>
+
+// Clicks an element by backendNodeId (or nodeId) with real input events, in
+// place of resolving a selector/xpath and clicking through a locator, or
+// Runtime.evaluate("el.click()"), which skips hit testing and pointer events.
+//
+// Commands go out in pipelined batches; Chrome runs a session's commands in
+// order, so a batch only costs one round trip:
+//
+//   1. DOM.scrollIntoViewIfNeeded + DOM.getContentQuads
+//        the scroll is a no-op when the element is already visible, and the
+//        quads are read after it, in viewport coordinates.
+//   2. Input.dispatchMouseEvent mouseMoved + mousePressed + mouseReleased
+//        at the centre of the element's largest quad.
+//
+// Elements without content quads (e.g. inline elements split oddly, or
+// Chrome builds without getContentQuads) take one extra DOM.getBoxModel trip.
+// Like PdfStreamExport, this is a reply-driven state machine: send each batch
+// from start()/next(), collect the replies' results in the same order (null
+// for an error) and pass them to next() until it returns null.
+//
+//   DirectClick click = DirectClick::backend_node(42);
+//   json batch = click.start();
+//   while (!batch.is_null()) batch = click.next(send_batch(batch));
+class DirectClick {
+public:
+    static DirectClick backend_node(int id) { return DirectClick("backendNodeId", id); }
+    static DirectClick node(int id) { return DirectClick("nodeId", id); }
+
+    // Returns the first batch: an array of {"method", "params"}.
+    nlohmann::json start() {
+        state_ = State::Locating;
+        return nlohmann::json::array({command("DOM.scrollIntoViewIfNeeded", target()),
+                                      command("DOM.getContentQuads", target())});
+    }
+
+    // results holds one entry per command of the previous batch. Returns the
+    // next batch, or null when the click has been dispatched or has failed.
+    nlohmann::json next(const nlohmann::json &results) {
+        switch (state_) {
+            case State::Locating: {
+                // The scroll's own result is ignored: older Chrome lacks the
+                // command, and the quads show whether the element is reachable.
+                const nlohmann::json &quads = result_at(results, 1);
+                if (quads.is_object() && quads.contains("quads") && pick_point(quads["quads"]))
+                    return press();
+                state_ = State::BoxModel;
+                round_trips_++;
+                return nlohmann::json::array({command("DOM.getBoxModel", target())});
+            }
+            case State::BoxModel: {
+                const nlohmann::json &box = result_at(results, 0);
+                if (!box.is_object() || !box.contains("model"))
+                    return fail("element has no layout box (hidden or detached)");
+                if (!pick_point(nlohmann::json::array({box["model"]["content"]})))
+                    return fail("element has an empty box");
+                return press();
+            }
+            case State::Pressing: {
+                for (size_t i = 0; i < 3; i++) {
+                    if (!result_at(results, i).is_object()) return fail("Input.dispatchMouseEvent failed");
+                }
+                state_ = State::Done;
+                return nullptr;
+            }
+            default:
+                return nullptr;
+        }
+    }
+
+    bool done() const { return state_ == State::Done; }
+    // The mouse events have been handed out: the page may have seen a click
+    // even if the click failed, so it must not be retried another way.
+    bool input_sent() const { return input_sent_; }
+    bool failed() const { return state_ == State::Failed; }
+    const std::string &error() const { return error_; }
+    double x() const { return x_; }
+    double y() const { return y_; }
+    // Batches sent, i.e. round trips when each batch is pipelined.
+    int round_trips() const { return round_trips_; }
+
+private:
+    enum class State { Idle, Locating, BoxModel, Pressing, Done, Failed };
+
+    DirectClick(const char *key, int id) : key_(key), id_(id) {}
+
+    const char *key_;
+    int id_;
+    State state_ = State::Idle;
+    double x_ = 0, y_ = 0;
+    int round_trips_ = 1;
+    bool input_sent_ = false;
+    std::string error_;
+
+    nlohmann::json target() const { return {{key_, id_}}; }
+
+    static nlohmann::json command(const char *method, nlohmann::json params) {
+        return {{"method", method}, {"params", std::move(params)}};
+    }
+
+    static const nlohmann::json &result_at(const nlohmann::json &results, size_t i) {
+        static const nlohmann::json none;
+        return results.is_array() && i < results.size() ? results[i] : none;
+    }
+
+    nlohmann::json press() {
+        state_ = State::Pressing;
+        input_sent_ = true;
+        round_trips_++;
+        nlohmann::json at = {{"x", x_}, {"y", y_}};
+        nlohmann::json moved = at, pressed = at, released = at;
+        moved["type"] = "mouseMoved";
+        pressed["type"] = "mousePressed";
+        released["type"] = "mouseReleased";
+        for (auto *p : {&pressed, &released}) {
+            (*p)["button"] = "left";
+            (*p)["buttons"] = p == &pressed ? 1 : 0;
+            (*p)["clickCount"] = 1;
+        }
+        return nlohmann::json::array({command("Input.dispatchMouseEvent", moved),
+                                      command("Input.dispatchMouseEvent", pressed),
+                                      command("Input.dispatchMouseEvent", released)});
+    }
+
+    // Centre of the largest quad; a wrapped link has one quad per line box.
+    bool pick_point(const nlohmann::json &quads) {
+        double best = 0;
+        for (const auto &q : quads) {
+            if (!q.is_array() || q.size() < 8) continue;
+            double px[4], py[4];
+            for (int i = 0; i < 4; i++) {
+                px[i] = q[2 * i].get<double>();
+                py[i] = q[2 * i + 1].get<double>();
+            }
+            double area = 0;
+            for (int i = 0; i < 4; i++) area += px[i] * py[(i + 1) % 4] - px[(i + 1) % 4] * py[i];
+            area = area < 0 ? -area / 2 : area / 2;
+            if (area > best) {
+                best = area;
+                x_ = (px[0] + px[1] + px[2] + px[3]) / 4;
+                y_ = (py[0] + py[1] + py[2] + py[3]) / 4;
+            }
+        }
+        return best > 0;
+    }
+
+    nlohmann::json fail(const std::string &message) {
+        error_ = message;
+        state_ = State::Failed;
+        return nullptr;
+    }
+};
+
+// Runs a click to completion over send_batch(batch), which sends every
+// command of the batch before waiting and returns their results in order.
+// *input_sent tells a failed click that never reached the page (safe to
+// retry another way) from one that may have.
+inline bool direct_click(const std::function<nlohmann::json(const nlohmann::json &)> &send_batch,
+                         DirectClick click, std::string *error = nullptr, bool *input_sent = nullptr) {
+    nlohmann::json batch = click.start();
+    try {
+        while (!batch.is_null()) batch = click.next(send_batch(batch));
+    } catch (...) {
+        if (input_sent) *input_sent = click.input_sent();
+        throw;
+    }
+    if (error) *error = click.error();
+    if (input_sent) *input_sent = click.input_sent();
+    return click.done();
+}
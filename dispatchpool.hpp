@@ -0,0 +1,145 @@
+// dispatchpool.hpp
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <ostream>
+#include <algorithm>
+#include "cdpsniff.hpp"
+
+// Takes complete messages off the lws thread so decoding them (json::parse,
+// the arena parser) and running their handlers (indexing, file writes) no
+// longer holds up reading the socket.
+//
+// Messages are queued per session key (cdp_session_key, see cdpsniff.hpp),
+// and a key is owned by at most one worker at a time, so one session's
+// messages are handled one after another in arrival order while different
+// sessions run in parallel. A worker hands a key back to the end of the
+// ready list after each message, so a session with a backlog does not
+// starve the others.
+//
+//   MessageDispatcher pool([](const std::string &session, const std::string &msg) { ... });
+//   LWS_CALLBACK_CLIENT_RECEIVE, final fragment:  pool.dispatch(std::move(payload));
+//   before lws_context_destroy():                 pool.close();
+//
+// The handler runs on a worker thread: anything it shares with the lws
+// callback must be atomic or locked, and it reaches the lws thread through
+// lws_cancel_service() rather than lws_callback_on_writable().
+class MessageDispatcher {
+public:
+    using Handler = std::function<void(const std::string &session, const std::string &message)>;
+
+    explicit MessageDispatcher(Handler handler, size_t threads = std::max(1u, std::thread::hardware_concurrency()))
+        : handler_(std::move(handler)) {
+        for (size_t i = 0; i < std::max<size_t>(threads, 1); i++) workers_.emplace_back([this] { work(); });
+    }
+
+    ~MessageDispatcher() { close(); }
+
+    MessageDispatcher(const MessageDispatcher &) = delete;
+    MessageDispatcher &operator=(const MessageDispatcher &) = delete;
+
+    void dispatch(std::string message) {
+        std::string key(cdp_session_key(message));
+        dispatch(std::move(key), std::move(message));
+    }
+
+    void dispatch(std::string key, std::string message) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) return;
+            Strand &strand = strands_[key];
+            strand.pending.push_back(std::move(message));
+            queued_++;
+            max_queued_ = std::max(max_queued_, queued_);
+            if (strand.scheduled) return;
+            strand.scheduled = true;
+            ready_.push_back(std::move(key));
+        }
+        work_cv_.notify_one();
+    }
+
+    // Blocks until every message dispatched so far has been handled.
+    void drain() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_cv_.wait(lock, [this] { return queued_ == 0; });
+    }
+
+    // Handles what is queued, then stops the workers.
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) return;
+            stopping_ = true;
+        }
+        work_cv_.notify_all();
+        for (auto &t : workers_) t.join();
+    }
+
+    void print_stats(std::ostream &out) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out << "dispatch: " << handled_ << " messages on " << workers_.size() << " threads, "
+            << busy_.count() / 1000 << " ms in handlers, longest " << longest_.count() / 1000 << " ms, backlog up to "
+            << max_queued_ << ", " << failed_ << " handler errors\n";
+    }
+
+private:
+    struct Strand {
+        std::deque<std::string> pending;
+        bool scheduled = false;  // in ready_ or owned by a worker
+    };
+
+    Handler handler_;
+    std::vector<std::thread> workers_;
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_, idle_cv_;
+    std::unordered_map<std::string, Strand> strands_;
+    std::deque<std::string> ready_;
+    bool stopping_ = false;
+    size_t queued_ = 0, max_queued_ = 0, handled_ = 0, failed_ = 0;
+    std::chrono::microseconds busy_{0}, longest_{0};
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            work_cv_.wait(lock, [this] { return stopping_ || !ready_.empty(); });
+            if (ready_.empty()) return;
+            std::string key = std::move(ready_.front());
+            ready_.pop_front();
+            std::string message = std::move(strands_[key].pending.front());
+            strands_[key].pending.pop_front();
+            lock.unlock();
+
+            auto start = std::chrono::steady_clock::now();
+            bool ok = true;
+            try {
+                handler_(key, message);
+            } catch (...) {
+                ok = false;
+            }
+            auto took = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+            lock.lock();
+            handled_++;
+            failed_ += !ok;
+            busy_ += took;
+            longest_ = std::max(longest_, took);
+            auto it = strands_.find(key);
+            if (it->second.pending.empty()) {
+                strands_.erase(it);  // detached sessions do not pile up
+            } else {
+                ready_.push_back(std::move(key));
+                work_cv_.notify_one();
+            }
+            if (--queued_ == 0) idle_cv_.notify_all();
+        }
+    }
+};
@@ -0,0 +1,390 @@
+// dommirror.hpp
+
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
+#include <cctype>
+#include <nlohmann/json.hpp>
+
+// Client-side copy of the page DOM, built once from DOM.getDocument
+// (depth -1) and then kept current from DOM.* mutation events, so the
+// interactive-element index between agent steps costs work proportional to
+// what changed instead of a full refetch.
+//
+// Interactive elements get a stable index when first seen; an element keeps
+// its index until it is removed, and removed indices are not reused until the
+// next build(). take_delta() reports which indices were added, removed or
+// changed since the previous call.
+//
+// Chrome reports an inserted node without its descendants (only
+// childNodeCount), and drops mutation events under nodes it has not sent.
+// The mirror asks for the missing subtrees itself: after apply_event() the
+// caller sends each command of take_requests() (DOM.requestChildNodes), and
+// the DOM.setChildNodes events they produce fill the nodes in.
+class DomMirror {
+public:
+    struct Node {
+        int node_id = 0;
+        int backend_node_id = 0;
+        int parent_id = 0;
+        int node_type = 0;
+        std::string node_name;   // lowercase tag name for elements
+        std::string node_value;  // text nodes
+        std::vector<std::pair<std::string, std::string>> attributes;
+        std::vector<int> children;
+    };
+
+    struct Delta {
+        std::vector<int> added;    // indices
+        std::vector<int> removed;  // indices
+        std::vector<int> changed;  // indices
+
+        bool empty() const { return added.empty() && removed.empty() && changed.empty(); }
+    };
+
+    // Replace the mirror with the tree from a DOM.getDocument result root.
+    // Json is nlohmann::json or, for large documents, a CdpValue from
+    // CdpArenaParser (cdpparse.hpp).
+    template <typename Json>
+    void build(const Json &root) {
+        nodes_.clear();
+        index_to_node_.clear();
+        node_to_index_.clear();
+        added_.clear();
+        removed_.clear();
+        changed_.clear();
+        requested_.clear();
+        requests_.clear();
+        next_index_ = 1;
+        root_id_ = root.value("nodeId", 0);
+        stale_ = false;
+        add_subtree(root, 0, -1);
+        // A fresh build is reported as "everything added".
+        for (const auto &[index, node_id] : index_to_node_) added_.insert(index);
+    }
+
+    // Apply one CDP message. Returns true if it was a DOM event the mirror
+    // consumed. After DOM.documentUpdated the mirror is stale() and the caller
+    // must refetch DOM.getDocument and build() again. Json is either type
+    // build() takes, so a message already parsed into the arena is not parsed
+    // again (DOM.setChildNodes can carry whole subtrees).
+    template <typename Json>
+    bool apply_event(const Json &msg) {
+        if (!msg.contains("method")) return false;
+        const std::string method = msg.value("method", "");
+        if (method.compare(0, 4, "DOM.") != 0) return false;
+        const Json &p = params_of(msg);
+
+        if (method == "DOM.setChildNodes") {
+            int parent = p.value("parentId", 0);
+            auto it = nodes_.find(parent);
+            if (it == nodes_.end()) return true;
+            requested_.erase(parent);
+            for (int child : std::vector<int>(it->second.children)) remove_subtree(child);
+            it->second.children.clear();
+            for (const auto &child : p["nodes"]) add_subtree(child, parent, -1);
+        } else if (method == "DOM.childNodeInserted") {
+            int parent = p.value("parentNodeId", 0);
+            auto it = nodes_.find(parent);
+            if (it == nodes_.end()) return true;
+            int previous = p.value("previousNodeId", 0);
+            auto &siblings = it->second.children;
+            int position = 0;
+            if (previous) {
+                auto pos = std::find(siblings.begin(), siblings.end(), previous);
+                position = pos == siblings.end() ? static_cast<int>(siblings.size())
+                                                 : static_cast<int>(pos - siblings.begin()) + 1;
+            }
+            add_subtree(p["node"], parent, position);
+        } else if (method == "DOM.childNodeCountUpdated") {
+            auto it = nodes_.find(p.value("nodeId", 0));
+            if (it != nodes_.end() && it->second.children.empty() && p.value("childNodeCount", 0) > 0)
+                request_children(it->first);
+        } else if (method == "DOM.childNodeRemoved") {
+            int parent = p.value("parentNodeId", 0);
+            int node_id = p.value("nodeId", 0);
+            auto it = nodes_.find(parent);
+            if (it != nodes_.end()) {
+                auto &siblings = it->second.children;
+                siblings.erase(std::remove(siblings.begin(), siblings.end(), node_id), siblings.end());
+            }
+            remove_subtree(node_id);
+        } else if (method == "DOM.attributeModified") {
+            set_attribute(p.value("nodeId", 0), p.value("name", ""), p.value("value", ""), false);
+        } else if (method == "DOM.attributeRemoved") {
+            set_attribute(p.value("nodeId", 0), p.value("name", ""), "", true);
+        } else if (method == "DOM.characterDataModified") {
+            auto it = nodes_.find(p.value("nodeId", 0));
+            if (it != nodes_.end()) {
+                it->second.node_value = p.value("characterData", "");
+                mark_changed(it->second.parent_id);
+            }
+        } else if (method == "DOM.documentUpdated") {
+            stale_ = true;
+        }
+        return true;
+    }
+
+    // DOM.requestChildNodes commands ({"method", "params"}) for nodes whose
+    // children Chrome has not sent yet; null when there are none.
+    nlohmann::json take_requests() {
+        if (requests_.empty()) return nullptr;
+        nlohmann::json batch = nlohmann::json::array();
+        for (int node_id : requests_) {
+            if (!requested_.count(node_id)) continue;  // removed meanwhile
+            batch.push_back({{"method", "DOM.requestChildNodes"},
+                             {"params", {{"nodeId", node_id}, {"depth", -1}, {"pierce", true}}}});
+        }
+        requests_.clear();
+        return batch.empty() ? nlohmann::json() : batch;
+    }
+
+    Delta take_delta() {
+        Delta d;
+        for (int index : added_) d.added.push_back(index);
+        for (int index : removed_) d.removed.push_back(index);
+        for (int index : changed_) {
+            if (!added_.count(index) && index_to_node_.count(index)) d.changed.push_back(index);
+        }
+        added_.clear();
+        removed_.clear();
+        changed_.clear();
+        return d;
+    }
+
+    const Node *find(int node_id) const {
+        auto it = nodes_.find(node_id);
+        return it == nodes_.end() ? nullptr : &it->second;
+    }
+
+    const std::string *attribute(const Node &node, const std::string &name) const {
+        for (const auto &[k, v] : node.attributes) {
+            if (k == name) return &v;
+        }
+        return nullptr;
+    }
+
+    // One-line summary: tag, identifying attributes and up to 40 chars of text.
+    std::string describe(int node_id) const {
+        const Node *node = find(node_id);
+        if (!node) return "";
+        std::string out = "<" + node->node_name;
+        for (const auto &[k, v] : node->attributes) {
+            if (k == "id" || k == "class" || k == "name" || k == "type" || k == "href" ||
+                k == "role" || k == "placeholder" || k == "aria-label" || k == "value") {
+                out += " " + k + "=\"" + v + "\"";
+            }
+        }
+        out += ">";
+        std::string text;
+        collect_text(*node, text, 40);
+        return out + text;
+    }
+
+    bool is_interactive(const Node &node) const {
+        if (node.node_type != 1) return false;
+        const std::string &tag = node.node_name;
+        if (tag == "a" || tag == "button" || tag == "input" || tag == "textarea" || tag == "select") return true;
+        const std::string *role = attribute(node, "role");
+        if (role && (*role == "button" || *role == "link" || *role == "checkbox" || *role == "tab" ||
+                     *role == "menuitem" || *role == "option")) {
+            return true;
+        }
+        return attribute(node, "onclick") != nullptr;
+    }
+
+    const std::map<int, int> &index_to_node() const { return index_to_node_; }
+    const std::unordered_map<int, int> &node_to_index() const { return node_to_index_; }
+    size_t size() const { return nodes_.size(); }
+    int root_id() const { return root_id_; }
+    bool stale() const { return stale_; }
+
+private:
+    std::unordered_map<int, Node> nodes_;
+    std::map<int, int> index_to_node_;
+    std::unordered_map<int, int> node_to_index_;
+    std::set<int> added_, removed_, changed_;
+    std::set<int> requested_;    // asked for, no DOM.setChildNodes yet
+    std::vector<int> requests_;  // not handed out by take_requests() yet
+    int next_index_ = 1;
+    int root_id_ = 0;
+    bool stale_ = true;
+    const nlohmann::json empty_ = nlohmann::json::object();
+
+    // A missing key is fine on a CdpValue (it reads as null) but not on a
+    // const nlohmann::json.
+    const nlohmann::json &params_of(const nlohmann::json &msg) const {
+        return msg.contains("params") ? msg["params"] : empty_;
+    }
+    template <typename Json>
+    const Json &params_of(const Json &msg) const {
+        return msg["params"];
+    }
+
+    // Explicit stack so deep pages cannot overflow the call stack; children
+    // are indexed in document order.
+    template <typename Json>
+    void add_subtree(const Json &top, int parent_id, int position) {
+        std::vector<std::pair<const Json *, int>> stack = {{&top, parent_id}};
+        bool first = true;
+        while (!stack.empty()) {
+            auto [json_node, parent] = stack.back();
+            stack.pop_back();
+
+            Node node;
+            node.node_id = json_node->value("nodeId", 0);
+            node.backend_node_id = json_node->value("backendNodeId", 0);
+            node.node_type = json_node->value("nodeType", 0);
+            node.parent_id = parent;
+            node.node_name = json_node->value("nodeName", "");
+            if (node.node_type == 1) {
+                for (auto &c : node.node_name) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            }
+            node.node_value = json_node->value("nodeValue", "");
+            if (json_node->contains("attributes")) {
+                const auto &attrs = (*json_node)["attributes"];
+                for (size_t i = 0; i + 1 < attrs.size(); i += 2) {
+                    node.attributes.emplace_back(attrs[i].template get<std::string>(),
+                                                 attrs[i + 1].template get<std::string>());
+                }
+            }
+
+            auto parent_it = nodes_.find(parent);
+            if (parent_it != nodes_.end()) {
+                auto &siblings = parent_it->second.children;
+                if (first && position >= 0 && position <= static_cast<int>(siblings.size())) {
+                    siblings.insert(siblings.begin() + position, node.node_id);
+                } else {
+                    siblings.push_back(node.node_id);
+                }
+            }
+            first = false;
+
+            int node_id = node.node_id;
+            bool interactive = is_interactive(node);
+            bool unsent_children = json_node->value("childNodeCount", 0) > 0 && !json_node->contains("children");
+            nodes_[node_id] = std::move(node);
+            if (interactive) assign_index(node_id);
+            if (node_type_is_text(node_id)) mark_changed(parent);
+            if (unsent_children) request_children(node_id);
+
+            // contentDocument / shadowRoots / children, pushed in reverse so
+            // they pop in document order.
+            std::vector<const Json *> kids;
+            if (json_node->contains("children")) {
+                for (const auto &child : (*json_node)["children"]) kids.push_back(&child);
+            }
+            if (json_node->contains("shadowRoots")) {
+                for (const auto &child : (*json_node)["shadowRoots"]) kids.push_back(&child);
+            }
+            if (json_node->contains("contentDocument")) kids.push_back(&(*json_node)["contentDocument"]);
+            for (auto it = kids.rbegin(); it != kids.rend(); ++it) stack.push_back({*it, node_id});
+        }
+    }
+
+    void request_children(int node_id) {
+        if (requested_.insert(node_id).second) requests_.push_back(node_id);
+    }
+
+    void remove_subtree(int node_id) {
+        std::vector<int> stack = {node_id};
+        while (!stack.empty()) {
+            int id = stack.back();
+            stack.pop_back();
+            auto it = nodes_.find(id);
+            if (it == nodes_.end()) continue;
+            if (it->second.node_type == 3) mark_changed(it->second.parent_id);
+            for (int child : it->second.children) stack.push_back(child);
+            release_index(id);
+            requested_.erase(id);
+            nodes_.erase(it);
+        }
+    }
+
+    void set_attribute(int node_id, const std::string &name, const std::string &value, bool removed) {
+        auto it = nodes_.find(node_id);
+        if (it == nodes_.end()) return;
+        auto &attrs = it->second.attributes;
+        auto attr = std::find_if(attrs.begin(), attrs.end(), [&](const auto &kv) { return kv.first == name; });
+        if (removed) {
+            if (attr != attrs.end()) attrs.erase(attr);
+        } else if (attr != attrs.end()) {
+            attr->second = value;
+        } else {
+            attrs.emplace_back(name, value);
+        }
+
+        // role/onclick edits can flip whether the element is interactive.
+        bool interactive = is_interactive(it->second);
+        bool indexed = node_to_index_.count(node_id) > 0;
+        if (interactive && !indexed) {
+            assign_index(node_id);
+        } else if (!interactive && indexed) {
+            release_index(node_id);
+        } else if (indexed) {
+            changed_.insert(node_to_index_[node_id]);
+        }
+    }
+
+    bool node_type_is_text(int node_id) const {
+        auto it = nodes_.find(node_id);
+        return it != nodes_.end() && it->second.node_type == 3;
+    }
+
+    void assign_index(int node_id) {
+        int index = next_index_++;
+        index_to_node_[index] = node_id;
+        node_to_index_[node_id] = index;
+        added_.insert(index);
+    }
+
+    void release_index(int node_id) {
+        auto it = node_to_index_.find(node_id);
+        if (it == node_to_index_.end()) return;
+        int index = it->second;
+        index_to_node_.erase(index);
+        node_to_index_.erase(it);
+        // Added and removed within one step: nothing to report.
+        if (!added_.erase(index)) removed_.insert(index);
+        changed_.erase(index);
+    }
+
+    // Text edits change the description of the nearest indexed ancestor.
+    void mark_changed(int node_id) {
+        for (int depth = 0; node_id && depth < 8; depth++) {
+            auto idx = node_to_index_.find(node_id);
+            if (idx != node_to_index_.end()) {
+                changed_.insert(idx->second);
+                return;
+            }
+            auto it = nodes_.find(node_id);
+            if (it == nodes_.end()) return;
+            node_id = it->second.parent_id;
+        }
+    }
+
+    void collect_text(const Node &node, std::string &out, size_t limit) const {
+        std::vector<int> stack(node.children.rbegin(), node.children.rend());
+        while (!stack.empty() && out.size() < limit) {
+            auto it = nodes_.find(stack.back());
+            stack.pop_back();
+            if (it == nodes_.end()) continue;
+            if (it->second.node_type == 3) {
+                for (char c : it->second.node_value) {
+                    if (out.size() >= limit) break;
+                    if (std::isspace(static_cast<unsigned char>(c))) {
+                        if (!out.empty() && out.back() != ' ') out += ' ';
+                    } else {
+                        out += c;
+                    }
+                }
+            }
+            for (auto c = it->second.children.rbegin(); c != it->second.children.rend(); ++c) stack.push_back(*c);
+        }
+    }
+};
@@ -0,0 +1,375 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <charconv>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Offline clickable-element indexing over saved pages.
+//
+//   htmlindexer [-j threads] [-o out.jsonl] [--tsv] [--list paths.txt] [path ...]
+//
+// Paths are HTML files or directories (searched recursively for .html/.htm);
+// --list reads one path per line, for dumps too large to pass as arguments.
+// Each file is memory-mapped and scanned once for the same elements the live
+// clients index (a, button, input, textarea, select), skipping comments and
+// script/style bodies. One line per file goes to a single output:
+//
+//   {"file":"p/1.html","bytes":51234,"elements":[{"i":1,"tag":"a","offset":812,"html":"<a href=\"/\">"}, ...]}
+//
+// or with --tsv one row per element: file, index, tag, offset, opening tag.
+// Files are spread over per-thread queues, largest first; a thread that runs
+// dry steals from the back of the fullest queue, so one huge page does not
+// leave the other cores idle at the end. Lines are in completion order.
+
+using steady = std::chrono::steady_clock;
+
+static const size_t MAX_TAG_BYTES = 512;  // opening tags longer than this are cut
+
+struct Element {
+    const char *tag;
+    size_t offset;
+    std::string_view html;
+};
+
+struct WorkItem {
+    std::string path;
+    uintmax_t size;
+};
+
+// One worker's share of the files. Owners take from the front (largest
+// first), thieves from the back.
+struct WorkQueue {
+    std::mutex mutex;
+    std::deque<WorkItem> items;
+};
+
+static bool tag_at(const char *p, const char *end, std::string_view name) {
+    if (static_cast<size_t>(end - p) <= name.size()) return false;
+    for (size_t i = 0; i < name.size(); i++) {
+        if ((p[i] | 0x20) != name[i]) return false;
+    }
+    char after = p[name.size()];
+    return after == '>' || after == '/' || after == ' ' || after == '\t' || after == '\n' || after == '\r' || after == '\f';
+}
+
+static const char *find_ci(const char *p, const char *end, std::string_view needle) {
+    while (p < end) {
+        p = static_cast<const char *>(std::memchr(p, '<', end - p));
+        if (!p) return end;
+        if (static_cast<size_t>(end - p) >= needle.size() &&
+            std::equal(needle.begin(), needle.end(), p, [](char a, char b) { return a == (b | 0x20); }))
+            return p;
+        p++;
+    }
+    return end;
+}
+
+// One pass over the page; the element list only points into the mapping.
+static void index_html(const char *data, size_t size, std::vector<Element> &out) {
+    static const char *const tags[] = {"a", "button", "input", "textarea", "select"};
+    const char *p = data, *end = data + size;
+    while (p < end) {
+        p = static_cast<const char *>(std::memchr(p, '<', end - p));
+        if (!p) break;
+        const char *name = p + 1;
+        if (end - name >= 3 && std::memcmp(name, "!--", 3) == 0) {
+            const char *close = static_cast<const char *>(memmem(name + 3, end - name - 3, "-->", 3));
+            p = close ? close + 3 : end;
+            continue;
+        }
+        if (tag_at(name, end, "script") || tag_at(name, end, "style")) {
+            p = find_ci(name, end, name[1] == 't' || name[1] == 'T' ? "</style" : "</script");
+            continue;
+        }
+        const char *matched = nullptr;
+        for (const char *tag : tags) {
+            if (tag_at(name, end, tag)) {
+                matched = tag;
+                break;
+            }
+        }
+        const char *gt = static_cast<const char *>(std::memchr(name, '>', end - name));
+        const char *tag_end = gt ? gt + 1 : end;
+        if (matched) {
+            size_t len = std::min<size_t>(tag_end - p, MAX_TAG_BYTES);
+            // Cut before a multi-byte character rather than through it.
+            if (len < static_cast<size_t>(tag_end - p))
+                while (len > 0 && (static_cast<unsigned char>(p[len]) & 0xC0) == 0x80) len--;
+            out.push_back({matched, static_cast<size_t>(p - data), std::string_view(p, len)});
+        }
+        p = matched ? tag_end : p + 1;
+    }
+}
+
+// Length of the well-formed UTF-8 sequence starting at s[i], or 0.
+static size_t utf8_length(std::string_view s, size_t i) {
+    unsigned char c = s[i];
+    size_t len = c >= 0xF0 && c <= 0xF4 ? 4 : c >= 0xE0 ? 3 : c >= 0xC2 && c < 0xE0 ? 2 : 0;
+    if (len == 0 || i + len > s.size()) return 0;
+    unsigned char c1 = s[i + 1];
+    // Overlong forms, surrogates and code points past U+10FFFF.
+    if ((c == 0xE0 && c1 < 0xA0) || (c == 0xED && c1 > 0x9F) || (c == 0xF0 && c1 < 0x90) || (c == 0xF4 && c1 > 0x8F))
+        return 0;
+    for (size_t k = 1; k < len; k++)
+        if ((static_cast<unsigned char>(s[i + k]) & 0xC0) != 0x80) return 0;
+    return len;
+}
+
+// Pages are not always UTF-8: a byte that does not start a well-formed
+// sequence is written as \u00XX, which reads it as Latin-1 (the usual
+// culprit) and keeps each line valid JSON.
+static void append_json_string(std::string &out, std::string_view s) {
+    out += '"';
+    for (size_t i = 0; i < s.size(); i++) {
+        size_t run = i;
+        while (run < s.size() && s[run] != '"' && s[run] != '\\' && static_cast<unsigned char>(s[run]) >= 0x20 &&
+               static_cast<unsigned char>(s[run]) < 0x80)
+            run++;
+        out.append(s.data() + i, run - i);
+        if (run == s.size()) break;
+        i = run;
+        char c = s[i];
+        if (static_cast<unsigned char>(c) >= 0x80) {
+            if (size_t len = utf8_length(s, i)) {
+                out.append(s.data() + i, len);
+                i += len - 1;
+            } else {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned char>(c));
+                out += buf;
+            }
+            continue;
+        }
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default: {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            }
+        }
+    }
+    out += '"';
+}
+
+static void append_tsv_field(std::string &out, std::string_view s) {
+    size_t start = out.size();
+    out.append(s);
+    for (size_t i = start; i < out.size(); i++) {
+        if (out[i] == '\t' || out[i] == '\n' || out[i] == '\r') out[i] = ' ';
+    }
+}
+
+static void append_number(std::string &out, size_t n) {
+    char buf[24];
+    out.append(buf, std::to_chars(buf, buf + sizeof(buf), n).ptr);
+}
+
+static void format_result(std::string &out, const std::string &path, size_t bytes,
+                          const std::vector<Element> &elements, bool tsv) {
+    if (tsv) {
+        for (size_t i = 0; i < elements.size(); i++) {
+            append_tsv_field(out, path);
+            out += '\t';
+            append_number(out, i + 1);
+            out.append("\t").append(elements[i].tag).append("\t");
+            append_number(out, elements[i].offset);
+            out += '\t';
+            append_tsv_field(out, elements[i].html);
+            out += '\n';
+        }
+        return;
+    }
+    out += "{\"file\":";
+    append_json_string(out, path);
+    out += ",\"bytes\":";
+    append_number(out, bytes);
+    out += ",\"elements\":[";
+    for (size_t i = 0; i < elements.size(); i++) {
+        if (i) out += ',';
+        out += "{\"i\":";
+        append_number(out, i + 1);
+        out.append(",\"tag\":\"").append(elements[i].tag).append("\",\"offset\":");
+        append_number(out, elements[i].offset);
+        out += ",\"html\":";
+        append_json_string(out, elements[i].html);
+        out += '}';
+    }
+    out += "]}\n";
+}
+
+class Indexer {
+public:
+    Indexer(size_t threads, std::ostream &out, bool tsv) : queues_(threads), out_(out), tsv_(tsv) {}
+
+    void run(std::vector<WorkItem> files) {
+        std::sort(files.begin(), files.end(), [](const WorkItem &a, const WorkItem &b) { return a.size > b.size; });
+        for (size_t i = 0; i < files.size(); i++) queues_[i % queues_.size()].items.push_back(std::move(files[i]));
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < queues_.size(); i++) workers.emplace_back([this, i] { work(i); });
+        for (auto &t : workers) t.join();
+    }
+
+    std::atomic<size_t> files{0}, failed{0}, bytes{0}, elements{0}, steals{0};
+
+private:
+    std::vector<WorkQueue> queues_;
+    std::ostream &out_;
+    std::mutex out_mutex_;
+    bool tsv_;
+
+    bool next(size_t self, WorkItem &item) {
+        {
+            std::lock_guard<std::mutex> lock(queues_[self].mutex);
+            if (!queues_[self].items.empty()) {
+                item = std::move(queues_[self].items.front());
+                queues_[self].items.pop_front();
+                return true;
+            }
+        }
+        // Steal the smallest remaining file of the fullest queue; it may have
+        // been emptied by the time it is locked, then look again.
+        while (true) {
+            size_t victim = self, most = 0;
+            for (size_t i = 0; i < queues_.size(); i++) {
+                if (i == self) continue;
+                std::lock_guard<std::mutex> lock(queues_[i].mutex);
+                if (queues_[i].items.size() > most) victim = i, most = queues_[i].items.size();
+            }
+            if (victim == self) return false;
+            std::lock_guard<std::mutex> lock(queues_[victim].mutex);
+            if (queues_[victim].items.empty()) continue;
+            item = std::move(queues_[victim].items.back());
+            queues_[victim].items.pop_back();
+            steals++;
+            return true;
+        }
+    }
+
+    void work(size_t self) {
+        std::vector<Element> found;
+        std::string buffer;
+        WorkItem item;
+        while (next(self, item)) {
+            found.clear();
+            int fd = open(item.path.c_str(), O_RDONLY);
+            struct stat st;
+            if (fd < 0 || fstat(fd, &st) != 0) {
+                if (fd >= 0) close(fd);
+                failed++;
+                continue;
+            }
+            size_t size = static_cast<size_t>(st.st_size);
+            void *map = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+            close(fd);
+            if (size && map == MAP_FAILED) {
+                failed++;
+                continue;
+            }
+            if (map) {
+                madvise(map, size, MADV_SEQUENTIAL);
+                index_html(static_cast<const char *>(map), size, found);
+            }
+            // The element views point into the mapping, so format before unmapping.
+            format_result(buffer, item.path, size, found, tsv_);
+            if (map) munmap(map, size);
+
+            files++;
+            bytes += size;
+            elements += found.size();
+            if (buffer.size() >= (1 << 20)) flush(buffer);
+        }
+        flush(buffer);
+    }
+
+    void flush(std::string &buffer) {
+        if (buffer.empty()) return;
+        std::lock_guard<std::mutex> lock(out_mutex_);
+        out_.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+    }
+};
+
+static bool is_html_file(const std::filesystem::path &path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext == ".html" || ext == ".htm";
+}
+
+static void add_path(const std::string &arg, std::vector<WorkItem> &files) {
+    std::error_code ec;
+    if (std::filesystem::is_directory(arg, ec)) {
+        for (auto it = std::filesystem::recursive_directory_iterator(arg, ec);
+             it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+            if (ec) break;
+            if (it->is_regular_file(ec) && is_html_file(it->path())) files.push_back({it->path().string(), it->file_size(ec)});
+        }
+    } else {
+        uintmax_t size = std::filesystem::file_size(arg, ec);
+        files.push_back({arg, ec ? 0 : size});
+    }
+}
+
+int main(int argc, char **argv) {
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string output = "indexed.jsonl";
+    bool tsv = false;
+    std::vector<WorkItem> files;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "-o" && i + 1 < argc) output = argv[++i];
+        else if (arg == "--tsv") tsv = true;
+        else if (arg == "--list" && i + 1 < argc) {
+            std::ifstream list(argv[++i]);
+            std::string line;
+            while (std::getline(list, line)) {
+                if (!line.empty()) add_path(line, files);
+            }
+        } else {
+            add_path(arg, files);
+        }
+    }
+    if (files.empty()) {
+        std::cerr << "usage: htmlindexer [-j threads] [-o out.jsonl] [--tsv] [--list paths.txt] [path ...]\n";
+        return 1;
+    }
+
+    std::ofstream out(output, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "cannot open " << output << "\n";
+        return 1;
+    }
+
+    auto start = steady::now();
+    Indexer indexer(threads, out, tsv);
+    indexer.run(std::move(files));
+    out.close();
+    double seconds = std::chrono::duration<double>(steady::now() - start).count();
+
+    std::printf("%zu files (%zu failed), %.1f MB, %zu elements in %.2f s on %zu threads: %.1f MB/s, %.0f files/s, %zu steals\n",
+                indexer.files.load(), indexer.failed.load(), indexer.bytes.load() / 1e6, indexer.elements.load(), seconds,
+                threads, indexer.bytes.load() / 1e6 / seconds, indexer.files.load() / seconds, indexer.steals.load());
+    std::printf("results in %s\n", output.c_str());
+    return 0;
+}
@@ -3,16 +3,30 @@
 #include <vector>
 #include <iostream>
 #include <map>
+#include <set>
+#include <memory>
+#include <mutex>
 #include <json/json.h> // Assuming a JSON library
 #include "browser_use/agent/views.h"
 #include "browser_use/browser/context.h"
 #include "browser_use/controller/registry/service.h"
 #include "browser_use/controller/views.h"
 #include "browser_use/utils.h"
+#include "pdfstream.hpp"
+#include "directclick.hpp"
+#include "prefetch.hpp"
+#include "objectcache.hpp"
+#include "tabpool.hpp"
 
 // Assume all blackbox classes are available with same names and methods.
 // For example: Page, BrowserContext, Registry, ActionModel, ActionResult, etc.
 
+// Assume Page::target_id() returns the id of the page's CDP target, which
+// stays the same for the life of the tab.
+inline std::string page_target_id(Page& page) {
+    return page.target_id();
+}
+
 template<typename Context>
 class Controller {
 public:
@@ -126,8 +140,8 @@ public:
         registry.action(
             "Click element by index",
             typeid(ClickElementAction),
-            [](ClickElementAction params, BrowserContext& browser) -> std::future<ActionResult> {
-                return std::async(std::launch::async, [&params, &browser]() -> ActionResult {
+            [this](ClickElementAction params, BrowserContext& browser) -> std::future<ActionResult> {
+                return std::async(std::launch::async, [this, &params, &browser]() -> ActionResult {
                     auto session = browser.get_session().get();
 
                     auto selector_map = browser.get_selector_map().get();
@@ -147,7 +161,27 @@ public:
 
                     std::string msg;
                     try {
-                        auto download_path = browser._click_element_node(element_node).get();
+                        // Fast path: click the indexed node by backendNodeId with
+                        // input events (directclick.hpp), two round trips on the page's
+                        // kept session, instead of re-resolving its xpath through a
+                        // locator. Nodes without a box fall back to the locator path,
+                        // but only while no mouse event has gone out, so nothing is
+                        // clicked twice. Downloads are only caught by the locator path
+                        // (expect_download), so it keeps clicks while they are saved.
+                        // Assume the DOM element node keeps the backendNodeId from the tree,
+                        // and BrowserContext::config is its BrowserContextConfig.
+                        std::string download_path;
+                        bool clicked = false;
+                        if (element_node.backend_node_id > 0 && browser.config.save_downloads_path.empty()) {
+                            auto page = browser.get_current_page().get();
+                            std::string error;
+                            bool input_sent = false;
+                            clicked = click_backend_node(browser, page, element_node.backend_node_id, error, input_sent);
+                            if (!clicked && input_sent) throw std::runtime_error("click was dispatched but failed: " + error);
+                            // As _click_element_node does after its click.
+                            if (clicked) page.wait_for_load_state().get();
+                        }
+                        if (!clicked) download_path = browser._click_element_node(element_node).get();
                         if (!download_path.empty()) {
                             msg = "💾  Downloaded file to " + download_path;
                         } else {
@@ -197,20 +231,28 @@ public:
         );
 
         // Save PDF
+        // Streamed through IO.read in chunks (pdfstream.hpp) so a long page never
+        // sits in memory as one base64 string.
         registry.action(
             "Save the current page as a PDF file",
             [](BrowserContext& browser) -> std::future<ActionResult> {
                 return std::async(std::launch::async, [&browser]() -> ActionResult {
                     auto page = browser.get_current_page().get();
-                    std::string short_url = std::regex_replace(page.url, std::regex("^https?://(?:www\\.)?|/$"), "");
-                    std::string slug = std::regex_replace(short_url, std::regex("[^a-zA-Z0-9]+"), "-");
-                    while (!slug.empty() && slug.front() == '-') slug.erase(slug.begin());
-                    while (!slug.empty() && slug.back() == '-') slug.pop_back();
-                    std::transform(slug.begin(), slug.end(), slug.begin(), ::tolower);
-                    std::string sanitized_filename = slug + ".pdf";
+                    std::string sanitized_filename = pdf_filename_for_url(page.url);
 
                     page.emulate_media("screen").get();
-                    page.pdf(sanitized_filename, "A4", false).get();
+                    // Assume new_cdp_session returns a CDPSession whose send() yields the result as nlohmann::json
+                    auto cdp = browser.new_cdp_session(page).get();
+                    std::string error;
+                    bool ok = export_pdf(
+                        [&cdp](const std::string& method, const nlohmann::json& params) {
+                            return cdp.send(method, params).get();
+                        },
+                        sanitized_filename, &error);
+                    cdp.detach().get();
+                    if (!ok) {
+                        return ActionResult(true, false, "", false, "Failed to save PDF: " + error);
+                    }
                     std::string msg = "Saving page with URL " + page.url + " as PDF to ./" + sanitized_filename;
                     std::cout << msg << std::endl;
                     return ActionResult(false, true, msg, true);
@@ -218,6 +260,42 @@ public:
             }
         );
 
+        // Save every open tab as PDF; each tab streams over its own session concurrently.
+        registry.action(
+            "Save all open tabs as PDF files",
+            [](BrowserContext& browser) -> std::future<ActionResult> {
+                return std::async(std::launch::async, [&browser]() -> ActionResult {
+                    auto session = browser.get_session().get();
+                    std::vector<std::future<std::string>> exports;
+                    std::set<std::string> filenames;
+                    for (auto& page : session.context.pages) {
+                        // Tabs on the same url would otherwise stream into one .part file.
+                        std::string base = pdf_filename_for_url(page.url), filename = base;
+                        for (int n = 2; !filenames.insert(filename).second; n++) {
+                            filename = base.substr(0, base.size() - 4) + "-" + std::to_string(n) + ".pdf";
+                        }
+                        // session outlives the exports: they are all waited for below.
+                        exports.push_back(std::async(std::launch::async, [&browser, &page, filename]() -> std::string {
+                            page.emulate_media("screen").get();
+                            auto cdp = browser.new_cdp_session(page).get();
+                            std::string error;
+                            bool ok = export_pdf(
+                                [&cdp](const std::string& method, const nlohmann::json& params) {
+                                    return cdp.send(method, params).get();
+                                },
+                                filename, &error);
+                            cdp.detach().get();
+                            return ok ? "./" + filename : page.url + " failed: " + error;
+                        }));
+                    }
+                    std::string msg = "Saved " + std::to_string(exports.size()) + " tabs as PDF:";
+                    for (auto& e : exports) msg += "\n" + e.get();
+                    std::cout << msg << std::endl;
+                    return ActionResult(false, true, msg, true);
+                });
+            }
+        );
+
         // Switch tab
         registry.action(
             "Switch tab",
@@ -238,9 +316,17 @@ public:
         registry.action(
             "Open url in new tab",
             typeid(OpenTabAction),
-            [](OpenTabAction params, BrowserContext& browser) -> std::future<ActionResult> {
-                return std::async(std::launch::async, [&params, &browser]() -> ActionResult {
-                    browser.create_new_tab(params.url).get();
+            [this](OpenTabAction params, BrowserContext& browser) -> std::future<ActionResult> {
+                return std::async(std::launch::async, [this, &params, &browser]() -> ActionResult {
+                    if (tab_pool) {
+                        auto lease = tab_pool->acquire();
+                        browser.adopt_tab(lease.tab).get();
+                        tab_pool->first_command(lease);
+                        lease.tab.goto(params.url).get();
+                        lease.tab.wait_for_load_state().get();
+                    } else {
+                        browser.create_new_tab(params.url).get();
+                    }
                     browser.get_agent_current_page().get();
                     std::string msg = "🔗  Opened new tab with " + params.url;
                     std::cout << msg << std::endl;
@@ -252,16 +338,19 @@ public:
 registry.action(
             "Get all options from a native dropdown",
             [this](int index, BrowserContext& browser) -> std::future<ActionResult> {
-                return std::async(std::launch::async, [index, &browser]() -> ActionResult {
+                return std::async(std::launch::async, [this, index, &browser]() -> ActionResult {
                     try {
                         auto page = browser.get_current_page().get();
                         auto selector_map = browser.get_selector_map().get();
                         auto dom_element = selector_map[index];
 
-                        std::vector<std::string> all_options;
+                        // Cached remote object first (objectcache.hpp): no lookup
+                        // script per frame; the xpath search below is the fallback.
+                        std::vector<std::string> all_options = dropdown_options_by_node(page, dom_element.backend_node_id);
                         int frame_index = 0;
 
                         for (auto& frame : page.frames) {
+                            if (!all_options.empty()) break;
                             try {
                                 // Evaluate JS in the frame to get dropdown options
                                 // The lambda and JS are passed as in Python, assuming frame.evaluate exists
@@ -390,17 +479,20 @@ registry.action(
 registry.action(
     "Get all options from a native dropdown",
     [this](int index, BrowserContext& browser) -> std::future<ActionResult> {
-        return std::async(std::launch::async, [index, &browser]() -> ActionResult {
+        return std::async(std::launch::async, [this, index, &browser]() -> ActionResult {
             try {
                 // Get current page and selector map
                 auto page = browser.get_current_page().get();
                 auto selector_map = browser.get_selector_map().get();
                 auto dom_element = selector_map[index];
 
-                std::vector<std::string> all_options;
+                // Cached remote object first (objectcache.hpp); the per-frame
+                // xpath search below is the fallback.
+                std::vector<std::string> all_options = dropdown_options_by_node(page, dom_element.backend_node_id);
                 int frame_index = 0;
 
                 for (auto& frame : page.frames) {
+                    if (!all_options.empty()) break;
                     try {
                         // Evaluate JavaScript in the frame to extract dropdown options
                         Json::Value options = frame.evaluate(R"(
@@ -497,7 +589,7 @@ registry.action(
 registry.action(
     "Select dropdown option for interactive element index by the text of the option you want to select",
     [this](int index, std::string text, BrowserContext& browser) -> std::future<ActionResult> {
-        return std::async(std::launch::async, [index, text, &browser]() -> ActionResult {
+        return std::async(std::launch::async, [this, index, text, &browser]() -> ActionResult {
             try {
                 auto page = browser.get_current_page().get();
                 auto selector_map = browser.get_selector_map().get();
@@ -509,6 +601,32 @@ registry.action(
                     return ActionResult(false, true, msg, true);
                 }
 
+                // Select through the cached remote object when there is one
+                // (objectcache.hpp), without searching every frame by xpath.
+                nlohmann::json selected = call_on_element(page, dom_element.backend_node_id, R"js(
+                    function(text) {
+                        if (this.tagName.toLowerCase() !== 'select')
+                            return {found: false, error: `Found element but it's a ${this.tagName}, not a SELECT`};
+                        const options = Array.from(this.options);
+                        const option = options.find(o => o.text.trim() === text.trim()) || options.find(o => o.value === text);
+                        if (!option) return {found: true, selected: false};
+                        this.value = option.value;
+                        this.dispatchEvent(new Event('input', {bubbles: true}));
+                        this.dispatchEvent(new Event('change', {bubbles: true}));
+                        return {found: true, selected: true, value: option.value};
+                    }
+                )js", nlohmann::json::array({{{"value", text}}}));
+                if (selected.is_object() && selected.value("selected", false)) {
+                    std::string msg = "selected option " + text + " with value " + selected.value("value", std::string());
+                    std::cout << msg << std::endl;
+                    return ActionResult(false, true, msg, true);
+                }
+                if (selected.is_object() && selected.value("found", false)) {
+                    std::string msg = "Could not select option '" + text + "': the dropdown has no such option";
+                    std::cout << msg << std::endl;
+                    return ActionResult(false, true, msg, true);
+                }
+
                 std::string xpath = "//" + dom_element.xpath;
 
                 int frame_index = 0;
@@ -885,6 +1003,11 @@ registry.action(
                         context
                     );
                     auto result = result_future.get();
+                    // The model's turn starts now; capture the next state meanwhile.
+                    if (state_prefetch) {
+                        watch_prefetch_page(browser_context);
+                        state_prefetch->arm();
+                    }
 
                     // Laminar.set_span_output(result); // If you use Laminar, add here
 
@@ -905,6 +1028,151 @@ registry.action(
         }
     }
 
+    // Capture the next step's page state in the background after each action
+    // (prefetch.hpp). Page-change events come from a CDP session on the current
+    // page; assume CDPSession::on(event, handler) passes the params as nlohmann::json.
+    void enable_state_prefetch(BrowserContext& browser) {
+        state_prefetch = std::make_unique<StatePrefetcher<BrowserState>>(
+            [&browser]() { return browser.get_state().get(); });
+        watch_prefetch_page(browser);
+    }
+
+    // Moves the prefetch session to the current page when it is no longer the
+    // one watched (a tab switch, a new tab), so its events are about the page
+    // get_state() captures. Chrome only reports mutations of nodes it has sent
+    // to the session, so the whole document is requested on attach and again
+    // after every DOM.documentUpdated.
+    void watch_prefetch_page(BrowserContext& browser) {
+        if (!state_prefetch) return;
+        auto page = browser.get_current_page().get();
+        std::string target = page_target_id(page);
+        if (prefetch_session && target == prefetch_target) return;
+        if (prefetch_session) prefetch_session->detach().get();
+        prefetch_target = target;
+        prefetch_session = std::make_unique<CDPSession>(browser.new_cdp_session(page).get());
+        CDPSession* session = prefetch_session.get();
+        session->send("Page.enable", nlohmann::json::object()).get();
+        session->send("DOM.enable", nlohmann::json::object()).get();
+        for (const char* event : {"Page.frameNavigated", "Page.navigatedWithinDocument", "Page.frameStartedLoading",
+                                  "Page.frameStoppedLoading", "Page.loadEventFired", "DOM.documentUpdated",
+                                  "DOM.childNodeInserted", "DOM.childNodeRemoved", "DOM.attributeModified",
+                                  "DOM.attributeRemoved", "DOM.characterDataModified"}) {
+            std::string method = event;
+            session->on(method, [this, session, method](const nlohmann::json& params) {
+                state_prefetch->on_event({{"method", method}, {"params", params}});
+                // Not awaited: this runs on the session's event thread.
+                if (method == "DOM.documentUpdated") session->send("DOM.getDocument", {{"depth", -1}});
+            });
+        }
+        session->send("DOM.getDocument", {{"depth", -1}}).get();
+        state_prefetch->invalidate();
+    }
+
+    // State for the step that is starting: the prefetched capture if the page
+    // has not changed since, else a fresh one.
+    BrowserState next_state(BrowserContext& browser) {
+        if (state_prefetch) {
+            watch_prefetch_page(browser);
+            if (auto state = state_prefetch->take()) return std::move(*state);
+        }
+        return browser.get_state().get();
+    }
+
+    // Keep backendNodeId -> objectId handles (objectcache.hpp) on a session of
+    // their own, since object ids belong to the session that resolved them.
+    // The cache follows the page the element is looked up in: on another
+    // page's element the previous page's handles are released and a new
+    // session is attached, so no node is ever resolved in the wrong page.
+    void enable_node_object_cache(BrowserContext& browser) {
+        std::lock_guard<std::mutex> lock(node_object_mutex);
+        node_object_browser = &browser;
+        attach_node_objects(browser.get_current_page().get());
+    }
+
+    void release_node_objects() {
+        std::lock_guard<std::mutex> lock(node_object_mutex);
+        detach_node_objects();
+        node_object_browser = nullptr;
+    }
+
+    // function's return value on the element of page, or null without a
+    // backendNodeId, without enable_node_object_cache(), or when the node is gone.
+    nlohmann::json call_on_element(Page& page, int backend_node_id, const std::string& function,
+                                   const nlohmann::json& arguments = nlohmann::json::array()) {
+        if (backend_node_id <= 0) return nullptr;
+        std::lock_guard<std::mutex> lock(node_object_mutex);
+        if (!node_object_browser) return nullptr;
+        if (page_target_id(page) != node_object_target) attach_node_objects(page);
+        return call_on_node(
+            [this](const std::string& method, const nlohmann::json& params) {
+                return node_object_session->send(method, params).get();
+            },
+            *node_objects, backend_node_id, function, arguments);
+    }
+
+    // "index: text=..." lines for get_dropdown_options, empty when the element
+    // is not a select or could not be reached through the cache.
+    std::vector<std::string> dropdown_options_by_node(Page& page, int backend_node_id) {
+        nlohmann::json options = call_on_element(page, backend_node_id, R"js(
+            function() {
+                if (this.tagName.toLowerCase() !== 'select') return null;
+                return Array.from(this.options).map(o => ({text: o.text, index: o.index}));
+            }
+        )js");
+        std::vector<std::string> lines;
+        if (!options.is_array()) return lines;
+        for (const auto& opt : options) {
+            lines.push_back(std::to_string(opt.value("index", 0)) + ": text=" + opt.value("text", nlohmann::json("")).dump());
+        }
+        return lines;
+    }
+
+    // Open tabs from `size` pre-created, reset tabs (tabpool.hpp); tabs given
+    // back with return_tab() are reset and reused. Assume the session's
+    // context can open pages BrowserContext does not list (context.new_page()),
+    // that adopt_tab(page) lists one and makes it current like create_new_tab(),
+    // and that detach_tab(page) unlists it without closing it.
+    void enable_tab_pool(BrowserContext& browser, size_t size = 2) {
+        tab_pool.reset();
+        TabPool<Page>::Hooks hooks;
+        hooks.create = [&browser]() { return browser.get_session().get().context.new_page().get(); };
+        hooks.reset = [&browser](Page& page) {
+            // Origins open in the agent's tabs keep their storage; asked per origin
+            // just before clearing, since tasks keep navigating while this runs.
+            auto origin_in_use = [&browser](const std::string& origin) {
+                for (const auto& tab : browser.get_tabs_info().get()) {
+                    if (url_origin(tab.url) == origin) return true;
+                }
+                return false;
+            };
+            auto cdp = browser.new_cdp_session(page).get();
+            bool ok = reset_tab(
+                [&cdp](const std::string& method, const nlohmann::json& params) { return cdp.send(method, params).get(); },
+                origin_in_use);
+            cdp.detach().get();
+            return ok;
+        };
+        hooks.destroy = [](Page& page) { page.close().get(); };
+        tab_pool = std::make_unique<TabPool<Page>>(std::move(hooks), size);
+    }
+
+    // Takes tab page_id away from the agent; with the pool it is reset and
+    // reused, without it closed.
+    void return_tab(BrowserContext& browser, int page_id) {
+        browser.switch_to_tab(page_id).get();
+        auto page = browser.get_current_page().get();
+        if (!tab_pool) {
+            page.close().get();
+            return;
+        }
+        browser.detach_tab(page).get();
+        tab_pool->release(std::move(page));
+    }
+
+    void print_tab_pool_stats() const {
+        if (tab_pool) tab_pool->print_stats(std::cout);
+    }
+
     // Helper for select_cell_or_range so it can be called from other lambdas
     std::future<ActionResult> select_cell_or_range(BrowserContext& browser, std::string cell_or_range) {
         return std::async(std::launch::async, [&browser, cell_or_range]() -> ActionResult {
@@ -925,4 +1193,111 @@ registry.action(
             return ActionResult(false, true, "Selected cell " + cell_or_range, false);
         });
     }
+
+private:
+    // Clicks the node with direct_click() on a session kept per page, so a
+    // click does not pay for attaching and detaching one. The lock is held
+    // for the whole click: a click on another tab would otherwise replace
+    // the session while this one is still sending on it.
+    bool click_backend_node(BrowserContext& browser, Page& page, int backend_node_id,
+                            std::string& error, bool& input_sent) {
+        std::lock_guard<std::mutex> lock(click_session_mutex);
+        try {
+            std::string target = page_target_id(page);
+            if (!click_cdp || target != click_target) {
+                drop_click_session_locked();
+                click_cdp = std::make_unique<CDPSession>(browser.new_cdp_session(page).get());
+                click_target = target;
+            }
+            CDPSession& cdp = *click_cdp;
+            return direct_click(
+                [&cdp](const nlohmann::json& batch) {
+                    std::vector<std::future<nlohmann::json>> replies;
+                    for (const auto& cmd : batch) replies.push_back(cdp.send(cmd["method"], cmd["params"]));
+                    nlohmann::json results = nlohmann::json::array();
+                    for (auto& reply : replies) {
+                        try {
+                            results.push_back(reply.get());
+                        } catch (const std::exception&) {
+                            results.push_back(nullptr);
+                        }
+                    }
+                    return results;
+                },
+                DirectClick::backend_node(backend_node_id), &error, &input_sent);
+        } catch (const std::exception& e) {
+            drop_click_session_locked();
+            error = e.what();
+            return false;
+        }
+    }
+
+    // With click_session_mutex held.
+    void drop_click_session_locked() {
+        if (!click_cdp) return;
+        try {
+            click_cdp->detach().get();
+        } catch (const std::exception&) {
+            // Gone with its page.
+        }
+        click_cdp.reset();
+        click_target.clear();
+    }
+
+    // Both with node_object_mutex held.
+    void attach_node_objects(Page page) {
+        detach_node_objects();
+        node_object_target = page_target_id(page);
+        node_objects = std::make_unique<RemoteObjectCache>();
+        node_object_session = std::make_unique<CDPSession>(node_object_browser->new_cdp_session(page).get());
+        CDPSession* session = node_object_session.get();
+        RemoteObjectCache* cache = node_objects.get();
+        session->send("Page.enable", nlohmann::json::object()).get();
+        session->send("DOM.enable", nlohmann::json::object()).get();
+        for (const char* event : {"Page.frameNavigated", "DOM.documentUpdated"}) {
+            std::string method = event;
+            session->on(method, [session, cache, method](const nlohmann::json& params) {
+                nlohmann::json releases = cache->on_event({{"method", method}, {"params", params}});
+                // Not awaited: this runs on the session's event thread.
+                if (releases.is_array()) {
+                    for (const auto& cmd : releases) session->send(cmd["method"], cmd["params"]);
+                }
+            });
+        }
+    }
+
+    void detach_node_objects() {
+        if (!node_object_session) return;
+        nlohmann::json releases = node_objects->release_all();
+        if (releases.is_array()) {
+            for (const auto& cmd : releases) {
+                try {
+                    node_object_session->send(cmd["method"], cmd["params"]).get();
+                } catch (const std::exception&) {
+                    // The page is gone, and its objects with it.
+                }
+            }
+        }
+        node_objects->print_stats(std::cout);
+        try {
+            node_object_session->detach().get();
+        } catch (const std::exception&) {
+        }
+        node_object_session.reset();
+        node_objects.reset();
+        node_object_target.clear();
+    }
+
+    std::unique_ptr<StatePrefetcher<BrowserState>> state_prefetch;
+    std::unique_ptr<CDPSession> prefetch_session;
+    std::string prefetch_target;
+    std::unique_ptr<RemoteObjectCache> node_objects;
+    std::unique_ptr<CDPSession> node_object_session;
+    std::string node_object_target;
+    BrowserContext* node_object_browser = nullptr;
+    std::mutex node_object_mutex;
+    std::unique_ptr<CDPSession> click_cdp;
+    std::string click_target;
+    std::mutex click_session_mutex;
+    std::unique_ptr<TabPool<Page>> tab_pool;
 };
@@ -0,0 +1,90 @@
+// mpscqueue.hpp
+
+#pragma once
+#include <atomic>
+#include <functional>
+#include <utility>
+
+// Unbounded multi-producer single-consumer queue (Vyukov's intrusive node
+// queue). push() is one atomic exchange plus a store and never blocks, so
+// worker threads can hand CDP commands to the lws service thread without a
+// mutex; pop() must only be called from that one consumer thread.
+//
+// A push whose exchange has happened but whose link is not yet stored is
+// briefly invisible to pop(); SubmissionQueue wakes the consumer after the
+// link, so nothing is left behind.
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() : head_(new Node()), tail_(head_.load(std::memory_order_relaxed)) {}
+
+    ~MpscQueue() {
+        T discard;
+        while (pop(discard)) {}
+        delete tail_;
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    void push(T value) {
+        Node *node = new Node(std::move(value));
+        Node *prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // Consumer only.
+    bool pop(T &out) {
+        Node *next = tail_->next.load(std::memory_order_acquire);
+        if (!next) return false;
+        out = std::move(next->value);
+        delete tail_;
+        tail_ = next;
+        return true;
+    }
+
+    // Consumer only.
+    bool empty() const { return tail_->next.load(std::memory_order_acquire) == nullptr; }
+
+private:
+    struct Node {
+        Node() = default;
+        explicit Node(T v) : value(std::move(v)) {}
+        std::atomic<Node *> next{nullptr};
+        T value{};
+    };
+
+    std::atomic<Node *> head_;  // last pushed; producers swap here
+    Node *tail_;                // consumed stub; consumer only
+};
+
+// MpscQueue plus a wakeup for a consumer blocked in its event loop, e.g.
+// lws_cancel_service(), which makes lws call the protocol callback with
+// LWS_CALLBACK_EVENT_WAIT_CANCELLED on the service thread. Only the first push
+// after the consumer last woke pays for the wakeup.
+//
+//   producer (any thread):  queue.push(cmd);
+//   EVENT_WAIT_CANCELLED:   queue.on_wake(); if (!queue.empty()) lws_callback_on_writable(wsi);
+//   CLIENT_WRITEABLE:       if (queue.pop(cmd)) write it; if (!queue.empty()) ask again
+template <typename T>
+class SubmissionQueue {
+public:
+    explicit SubmissionQueue(std::function<void()> wake) : wake_(std::move(wake)) {}
+
+    void push(T value) {
+        queue_.push(std::move(value));
+        if (!wake_pending_.exchange(true, std::memory_order_acq_rel)) wake_();
+    }
+
+    // Consumer, when woken and before draining: a push that lands after this
+    // wakes it again.
+    void on_wake() { wake_pending_.store(false, std::memory_order_seq_cst); }
+
+    bool pop(T &out) { return queue_.pop(out); }
+    bool empty() const { return queue_.empty(); }
+
+private:
+    MpscQueue<T> queue_;
+    std::atomic<bool> wake_pending_{false};
+    std::function<void()> wake_;
+};
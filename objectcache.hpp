@@ -0,0 +1,201 @@
+// objectcache.hpp
+
+#pragma once
+#include <string>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <optional>
+#include <functional>
+#include <ostream>
+#include <nlohmann/json.hpp>
+
+// backendNodeId -> remote objectId, so repeated operations on the same
+// element (reading a dropdown's options, then selecting one) go straight to
+// Runtime.callFunctionOn instead of resolving the element again, per frame,
+// by evaluating lookup JavaScript.
+//
+// Objects are resolved with DOM.resolveNode into one object group per page
+// generation ("<prefix>-<n>"). The renderer keeps them alive until the group
+// is released, so the cache never holds more than max_entries: past that,
+// and whenever on_event() sees the page change (main-frame navigation,
+// DOM.documentUpdated, execution contexts cleared), the whole group is
+// retired and freed with one Runtime.releaseObjectGroup.
+//
+// Object ids belong to the CDP session that resolved them: use one cache per
+// session. Like DirectClick this only builds commands and reads replies; the
+// caller sends them (call_on_node() below does it synchronously).
+//
+//   if (auto id = cache.lookup(backend)) call Runtime.callFunctionOn on *id
+//   else send cache.resolve_command(backend), then cache.on_resolved(backend, result)
+//   on every event:  send each command of cache.on_event(msg), if not null
+class RemoteObjectCache {
+public:
+    explicit RemoteObjectCache(std::string group_prefix = "agent-nodes", size_t max_entries = 256)
+        : prefix_(std::move(group_prefix)), max_entries_(max_entries) {}
+
+    std::optional<std::string> lookup(int backend_node_id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = objects_.find(backend_node_id);
+        if (it == objects_.end()) {
+            misses_++;
+            return std::nullopt;
+        }
+        hits_++;
+        return it->second;
+    }
+
+    // execution_context_id picks the world the object lives in (0: the
+    // page's main world).
+    nlohmann::json resolve_command(int backend_node_id, int execution_context_id = 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (objects_.size() >= max_entries_) retire();
+        resolving_[backend_node_id] = generation_;
+        nlohmann::json params = {{"backendNodeId", backend_node_id}, {"objectGroup", group_name(generation_)}};
+        if (execution_context_id) params["executionContextId"] = execution_context_id;
+        return {{"method", "DOM.resolveNode"}, {"params", std::move(params)}};
+    }
+
+    // result of the DOM.resolveNode reply (null for an error). Returns the
+    // objectId, or "" when the node no longer exists. A reply that comes back
+    // after the page changed is used once but not cached: its group is
+    // already retired.
+    std::string on_resolved(int backend_node_id, const nlohmann::json &result) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto pending = resolving_.find(backend_node_id);
+        bool current = pending != resolving_.end() && pending->second == generation_;
+        if (pending != resolving_.end()) resolving_.erase(pending);
+        if (!result.is_object() || !result.contains("object")) return "";
+        std::string object_id = result["object"].value("objectId", "");
+        if (object_id.empty() || !current) return object_id;
+        objects_[backend_node_id] = object_id;
+        used_ = true;
+        return object_id;
+    }
+
+    // The object was gone when used (its context died unseen); resolve again.
+    void forget(int backend_node_id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        objects_.erase(backend_node_id);
+    }
+
+    // Feed events of the cache's session. Returns the batch of
+    // Runtime.releaseObjectGroup commands to send, or null.
+    nlohmann::json on_event(const nlohmann::json &msg) {
+        const std::string method = msg.value("method", "");
+        if (method == "Page.frameNavigated") {
+            if (!msg.contains("params") || msg["params"]["frame"].contains("parentId")) return nullptr;
+        } else if (method != "DOM.documentUpdated" && method != "Runtime.executionContextsCleared") {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        invalidations_++;
+        retire();
+        return take_releases();
+    }
+
+    // Releases every group still held, e.g. before detaching the session.
+    // Returns a batch like on_event().
+    nlohmann::json release_all() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        retire();
+        return take_releases();
+    }
+
+    // Groups retired because the cache was full; send after resolving.
+    nlohmann::json pending_releases() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return take_releases();
+    }
+
+    std::string group() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return group_name(generation_);
+    }
+
+    void print_stats(std::ostream &out) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out << "node objects: " << hits_ << " hits, " << misses_ << " resolved, " << invalidations_
+            << " invalidations, " << released_ << " groups released\n";
+    }
+
+private:
+    std::string prefix_;
+    size_t max_entries_;
+    mutable std::mutex mutex_;
+    std::map<int, std::string> objects_;
+    unsigned long generation_ = 1;
+    std::map<int, unsigned long> resolving_;  // backendNodeId -> generation asked in
+    bool used_ = false;                        // anything resolved into the current group
+    std::vector<std::string> retired_;         // groups waiting for releaseObjectGroup
+    size_t hits_ = 0, misses_ = 0, invalidations_ = 0, released_ = 0;
+
+    std::string group_name(unsigned long generation) const { return prefix_ + "-" + std::to_string(generation); }
+
+    // Starts a new group; the old one is released only if anything was
+    // resolved into it.
+    void retire() {
+        if (used_ || !resolving_.empty()) retired_.push_back(group_name(generation_));
+        generation_++;
+        used_ = false;
+        objects_.clear();
+    }
+
+    nlohmann::json take_releases() {
+        if (retired_.empty()) return nullptr;
+        nlohmann::json batch = nlohmann::json::array();
+        for (auto &group : retired_)
+            batch.push_back({{"method", "Runtime.releaseObjectGroup"}, {"params", {{"objectGroup", std::move(group)}}}});
+        released_ += retired_.size();
+        retired_.clear();
+        return batch;
+    }
+};
+
+// Runs function (a JS function declaration, `this` is the element) on the
+// node through cache, resolving it first on a miss and once more if the
+// cached object turned out to be gone. send(method, params) returns the
+// command's result and throws on a CDP error. Returns the function's return
+// value (by value), or null if the node could not be resolved or the function
+// threw.
+inline nlohmann::json call_on_node(const std::function<nlohmann::json(const std::string &, const nlohmann::json &)> &send,
+                                   RemoteObjectCache &cache, int backend_node_id, const std::string &function,
+                                   const nlohmann::json &arguments = nlohmann::json::array()) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        std::optional<std::string> object_id = cache.lookup(backend_node_id);
+        if (!object_id) {
+            nlohmann::json command = cache.resolve_command(backend_node_id);
+            nlohmann::json result;
+            try {
+                result = send(command["method"], command["params"]);
+            } catch (const std::exception &) {
+                return nullptr;
+            }
+            object_id = cache.on_resolved(backend_node_id, result);
+            nlohmann::json releases = cache.pending_releases();
+            if (releases.is_array()) {
+                for (const auto &release : releases) {
+                    try {
+                        send(release["method"], release["params"]);
+                    } catch (const std::exception &) {
+                        // Gone with its context already.
+                    }
+                }
+            }
+            if (object_id->empty()) return nullptr;
+        }
+        nlohmann::json params = {{"objectId", *object_id},
+                                 {"functionDeclaration", function},
+                                 {"arguments", arguments},
+                                 {"returnByValue", true},
+                                 {"awaitPromise", true}};
+        try {
+            nlohmann::json result = send("Runtime.callFunctionOn", params);
+            if (result.contains("exceptionDetails") || !result.contains("result")) return nullptr;
+            return result["result"].value("value", nlohmann::json());
+        } catch (const std::exception &) {
+            cache.forget(backend_node_id);
+        }
+    }
+    return nullptr;
+}
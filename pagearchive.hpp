@@ -0,0 +1,353 @@
+// pagearchive.hpp
+
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <ostream>
+#include <optional>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+// Append-only archive of page captures (outerHTML, indexed HTML, element
+// lists), replacing the per-run files each client overwrote.
+//
+// PageArchive::append() only queues the capture with its timestamp, so it is
+// safe to call from the lws callback; a writer thread deflates each capture as
+// its own zlib stream and appends it to a segment:
+//
+//   dir/pages-000001.dat   records: "PGA1", timestamp_us u64, url_len u16,
+//                          kind_len u16, stored u32, raw u32, reserved u32,
+//                          url, kind, zlib data
+//   dir/pages-000001.idx   fixed 40-byte PageArchiveEntry per record
+//
+// A record's index entry is written only after its data, so a crash never
+// leaves an entry pointing past the end of a segment. Every run starts a new
+// segment after the existing ones, and one is also started once
+// segment_bytes is reached. A segment is claimed by creating its .dat with
+// O_EXCL, so clients sharing a directory never write into each other's.
+// PageArchiveReader maps the .idx files and reads any single capture back
+// with one pread and one inflate.
+struct PageArchiveEntry {
+    uint64_t timestamp_us;
+    uint64_t url_hash;   // FNV-1a of the URL
+    uint64_t offset;     // of the record in the segment's .dat
+    uint32_t stored_size;
+    uint32_t raw_size;
+    uint32_t kind_hash;  // FNV-1a of the kind, truncated
+    uint32_t reserved;
+};
+static_assert(sizeof(PageArchiveEntry) == 40, "index entries are read in place");
+
+inline uint64_t page_archive_hash(const std::string &s) {
+    uint64_t h = 1469598103934665603ull;
+    for (unsigned char c : s) h = (h ^ c) * 1099511628211ull;
+    return h;
+}
+
+inline int page_archive_last_segment(const std::string &dir) {
+    int last = 0;
+    std::error_code ec;
+    for (const auto &f : std::filesystem::directory_iterator(dir, ec)) {
+        std::string name = f.path().filename().string();
+        int n = 0;
+        if (std::sscanf(name.c_str(), "pages-%d.", &n) == 1) last = std::max(last, n);
+    }
+    return last;
+}
+
+class PageArchive {
+public:
+    struct Options {
+        size_t segment_bytes = 256 << 20;
+        int level = 6;
+    };
+
+    explicit PageArchive(std::string dir) : PageArchive(std::move(dir), Options()) {}
+
+    PageArchive(std::string dir, Options options) : dir_(std::move(dir)), options_(options) {
+        std::filesystem::create_directories(dir_);
+        segment_number_ = page_archive_last_segment(dir_);
+        writer_ = std::thread([this] { write_loop(); });
+    }
+
+    ~PageArchive() { close(); }
+
+    // kind names the capture, e.g. "outerHTML" or "interactives".
+    void append(std::string url, std::string kind, std::string content) {
+        Capture capture{now_us(), std::move(url), std::move(kind), std::move(content)};
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) return;
+            queue_.push_back(std::move(capture));
+        }
+        ready_.notify_one();
+    }
+
+    // Writes everything queued, then stops the writer.
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) return;
+            stopping_ = true;
+        }
+        ready_.notify_all();
+        writer_.join();
+        data_.close();
+        index_.close();
+    }
+
+    void print_stats(std::ostream &out) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out << "Page archive: " << written_ << " captures, " << raw_bytes_ / 1024 << " KiB stored in "
+            << stored_bytes_ / 1024 << " KiB (" << dir_ << ")\n";
+    }
+
+private:
+    struct Capture {
+        uint64_t timestamp_us;
+        std::string url;
+        std::string kind;
+        std::string content;
+    };
+
+    std::string dir_;
+    Options options_;
+    std::thread writer_;
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<Capture> queue_;
+    bool stopping_ = false;
+    size_t written_ = 0, raw_bytes_ = 0, stored_bytes_ = 0;
+
+    // Writer thread only.
+    std::ofstream data_;
+    std::ofstream index_;
+    int segment_number_ = 0;
+    uint64_t segment_size_ = 0;
+
+    static uint64_t now_us() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                         std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+
+    void write_loop() {
+        std::vector<unsigned char> compressed;
+        while (true) {
+            Capture capture;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+                if (queue_.empty()) return;
+                capture = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            uLongf size = compressBound(capture.content.size());
+            compressed.resize(size);
+            if (compress2(compressed.data(), &size, reinterpret_cast<const Bytef *>(capture.content.data()),
+                          capture.content.size(), options_.level) != Z_OK)
+                continue;
+            write_record(capture, compressed.data(), size);
+            std::lock_guard<std::mutex> lock(mutex_);
+            written_++;
+            raw_bytes_ += capture.content.size();
+            stored_bytes_ += size;
+        }
+    }
+
+    void write_record(const Capture &capture, const unsigned char *data, size_t size) {
+        if (!data_.is_open() || segment_size_ >= options_.segment_bytes) roll_segment();
+        size_t url_len = std::min<size_t>(capture.url.size(), 0xFFFF);
+        size_t kind_len = std::min<size_t>(capture.kind.size(), 0xFFFF);
+
+        unsigned char header[28];
+        std::memcpy(header, "PGA1", 4);
+        put_le(header + 4, capture.timestamp_us, 8);
+        put_le(header + 12, url_len, 2);
+        put_le(header + 14, kind_len, 2);
+        put_le(header + 16, size, 4);
+        put_le(header + 20, capture.content.size(), 4);
+        put_le(header + 24, 0, 4);
+        data_.write(reinterpret_cast<const char *>(header), sizeof(header));
+        data_.write(capture.url.data(), static_cast<std::streamsize>(url_len));
+        data_.write(capture.kind.data(), static_cast<std::streamsize>(kind_len));
+        data_.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+        data_.flush();
+
+        PageArchiveEntry entry{capture.timestamp_us, page_archive_hash(capture.url), segment_size_,
+                               static_cast<uint32_t>(size), static_cast<uint32_t>(capture.content.size()),
+                               static_cast<uint32_t>(page_archive_hash(capture.kind)), 0};
+        index_.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+        index_.flush();
+        segment_size_ += sizeof(header) + url_len + kind_len + size;
+    }
+
+    void roll_segment() {
+        data_.close();
+        index_.close();
+        segment_size_ = 0;
+        // Another writer may have taken the next number since we looked.
+        for (int attempt = 0; attempt < 1000; attempt++) {
+            char name[32];
+            std::snprintf(name, sizeof(name), "pages-%06d", ++segment_number_);
+            std::string base = dir_ + "/" + name;
+            int fd = ::open((base + ".dat").c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+            if (fd < 0) {
+                if (errno == EEXIST) continue;
+                return;  // records are dropped until the next roll
+            }
+            ::close(fd);
+            data_.open(base + ".dat", std::ios::binary | std::ios::app);
+            index_.open(base + ".idx", std::ios::binary | std::ios::trunc);
+            return;
+        }
+    }
+
+    static void put_le(unsigned char *out, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; i++) out[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+};
+
+// Random access to an archive written by PageArchive (also while it is still
+// being written: entries appended after open() are not seen).
+class PageArchiveReader {
+public:
+    struct Page {
+        uint64_t timestamp_us = 0;
+        std::string url;
+        std::string kind;
+        std::string content;
+    };
+
+    explicit PageArchiveReader(const std::string &dir) {
+        int last = page_archive_last_segment(dir);
+        for (int n = 1; n <= last; n++) {
+            char name[32];
+            std::snprintf(name, sizeof(name), "/pages-%06d", n);
+            Segment segment;
+            segment.data_fd = ::open((dir + name + ".dat").c_str(), O_RDONLY);
+            int index_fd = ::open((dir + name + ".idx").c_str(), O_RDONLY);
+            struct stat st;
+            if (segment.data_fd < 0 || index_fd < 0 || fstat(index_fd, &st) != 0) {
+                if (segment.data_fd >= 0) ::close(segment.data_fd);
+                if (index_fd >= 0) ::close(index_fd);
+                continue;
+            }
+            segment.count = static_cast<size_t>(st.st_size) / sizeof(PageArchiveEntry);
+            if (segment.count) {
+                void *map = mmap(nullptr, segment.count * sizeof(PageArchiveEntry), PROT_READ, MAP_SHARED, index_fd, 0);
+                if (map != MAP_FAILED) segment.entries = static_cast<const PageArchiveEntry *>(map);
+            }
+            ::close(index_fd);
+            if (!segment.entries) segment.count = 0;
+            segments_.push_back(segment);
+        }
+    }
+
+    ~PageArchiveReader() {
+        for (auto &s : segments_) {
+            if (s.entries) munmap(const_cast<PageArchiveEntry *>(s.entries), s.count * sizeof(PageArchiveEntry));
+            ::close(s.data_fd);
+        }
+    }
+
+    PageArchiveReader(const PageArchiveReader &) = delete;
+    PageArchiveReader &operator=(const PageArchiveReader &) = delete;
+
+    size_t size() const {
+        size_t n = 0;
+        for (const auto &s : segments_) n += s.count;
+        return n;
+    }
+
+    // The latest capture of url (of the given kind, if not empty) taken at or
+    // before timestamp_us. Only index entries are touched until a hash
+    // matches; the record header then confirms the URL.
+    std::optional<Page> find(const std::string &url, const std::string &kind = "",
+                             uint64_t timestamp_us = UINT64_MAX) const {
+        uint64_t url_hash = page_archive_hash(url);
+        uint32_t kind_hash = static_cast<uint32_t>(page_archive_hash(kind));
+        for (auto s = segments_.rbegin(); s != segments_.rend(); ++s) {
+            for (size_t i = s->count; i-- > 0;) {
+                const PageArchiveEntry &e = s->entries[i];
+                if (e.url_hash != url_hash || e.timestamp_us > timestamp_us) continue;
+                if (!kind.empty() && e.kind_hash != kind_hash) continue;
+                std::optional<Page> page = read(*s, e);
+                if (page && page->url == url && (kind.empty() || page->kind == kind)) return page;
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Calls f(entry) for every capture in write order, without reading data.
+    template <typename F>
+    void for_each(F f) const {
+        for (const auto &s : segments_) {
+            for (size_t i = 0; i < s.count; i++) f(s.entries[i]);
+        }
+    }
+
+private:
+    struct Segment {
+        int data_fd = -1;
+        const PageArchiveEntry *entries = nullptr;
+        size_t count = 0;
+    };
+
+    std::vector<Segment> segments_;
+
+    static uint64_t get_le(const unsigned char *in, int bytes) {
+        uint64_t v = 0;
+        for (int i = bytes - 1; i >= 0; i--) v = (v << 8) | in[i];
+        return v;
+    }
+
+    static std::optional<Page> read(const Segment &s, const PageArchiveEntry &e) {
+        unsigned char header[28];
+        if (pread(s.data_fd, header, sizeof(header), static_cast<off_t>(e.offset)) != sizeof(header) ||
+            std::memcmp(header, "PGA1", 4) != 0)
+            return std::nullopt;
+        size_t url_len = get_le(header + 12, 2), kind_len = get_le(header + 14, 2);
+        std::vector<unsigned char> record(url_len + kind_len + e.stored_size);
+        if (pread(s.data_fd, record.data(), record.size(), static_cast<off_t>(e.offset + sizeof(header))) !=
+            static_cast<ssize_t>(record.size()))
+            return std::nullopt;
+
+        Page page;
+        page.timestamp_us = e.timestamp_us;
+        page.url.assign(reinterpret_cast<const char *>(record.data()), url_len);
+        page.kind.assign(reinterpret_cast<const char *>(record.data()) + url_len, kind_len);
+        page.content.resize(e.raw_size);
+        uLongf raw = e.raw_size;
+        if (uncompress(reinterpret_cast<Bytef *>(page.content.data()), &raw, record.data() + url_len + kind_len,
+                       e.stored_size) != Z_OK || raw != e.raw_size)
+            return std::nullopt;
+        return page;
+    }
+};
+
+// Stores a capture in the archive when there is one (--archive), otherwise
+// overwrites file as the clients always did.
+inline void save_capture(PageArchive *archive, const std::string &url, const std::string &file,
+                         const std::string &content) {
+    if (archive) {
+        archive->append(url, file, content);
+        return;
+    }
+    std::ofstream out(file);
+    out << content;
+}
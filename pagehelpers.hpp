@@ -0,0 +1,295 @@
+// pagehelpers.hpp
+
+#pragma once
+#include <string>
+#include <map>
+#include <mutex>
+#include <nlohmann/json.hpp>
+
+// The JavaScript the actions run in pages (scrolling, scroll-to-text,
+// dropdown discovery and selection, clicking by selector), installed once per document as
+// window.__agent instead of sent as source with every Runtime.evaluate. A
+// call is then a short expression such as __agent.scrollPage(1, null), which
+// V8 compiles in microseconds.
+//
+// Every function takes only JSON-able arguments and returns JSON-able values
+// (returnByValue), so the same bundle serves the lws clients and the
+// Page::evaluate based controllers.
+inline const std::string &page_helpers_source() {
+    static const std::string source = R"js(
+(() => {
+    const VERSION = 3;
+    if (globalThis.__agent && globalThis.__agent.version >= VERSION) return;
+
+    const byXPath = (xpath) => document.evaluate(xpath, document, null,
+        XPathResult.FIRST_ORDERED_NODE_TYPE, null).singleNodeValue;
+
+    // Scroll-to-text matches are cached per document: a hit is re-checked
+    // and scrolled to without walking the tree, and a miss stays valid until
+    // the next DOM mutation, including class/style/hidden toggles that show
+    // text already in the tree.
+    const textState = { positions: new Map(), generation: 0, observing: false };
+    const observeText = () => {
+        if (textState.observing) return;
+        new MutationObserver(() => { textState.generation++; }).observe(document,
+            { subtree: true, childList: true, characterData: true,
+              attributes: true, attributeFilter: ['class', 'style', 'hidden'] });
+        textState.observing = true;
+    };
+    const rectOf = (node) => {
+        const range = document.createRange();
+        range.selectNodeContents(node);
+        return range.getBoundingClientRect();
+    };
+    const visible = (node) => {
+        const el = node.parentElement;
+        if (!el || (el.checkVisibility && !el.checkVisibility({ visibilityProperty: true }))) return false;
+        const r = rectOf(node);
+        return r.width > 0 && r.height > 0;
+    };
+    const reveal = (node, strategy, cached) => {
+        node.parentElement.scrollIntoView({ block: 'center', inline: 'nearest', behavior: 'instant' });
+        const r = rectOf(node);
+        return { found: true, strategy, cached, x: r.x, y: r.y, width: r.width, height: r.height };
+    };
+
+    globalThis.__agent = {
+        version: VERSION,
+
+        // direction 1 = down, -1 = up; pixels null = one viewport.
+        scrollPage(direction, pixels) {
+            window.scrollBy(0, direction * (pixels == null ? window.innerHeight : pixels));
+            return window.scrollY;
+        },
+
+        // One pass over the visible text nodes finds the best match for the
+        // three old locator strategies and scrolls to it instantly.
+        scrollToText(text) {
+            observeText();
+            const needle = text.replace(/\s+/g, ' ').trim();
+            const lower = needle.toLowerCase();
+            if (!needle) return { found: false, cached: false };
+
+            const hit = textState.positions.get(needle);
+            if (hit && hit.miss && hit.generation === textState.generation) return { found: false, cached: true };
+            if (hit && !hit.miss) {
+                const node = hit.node.deref();
+                if (node && node.isConnected && node.data.toLowerCase().includes(lower) && visible(node))
+                    return reveal(node, hit.strategy, true);
+            }
+            textState.positions.delete(needle);
+
+            // Rank 0: the whole text is the needle; 1: contains it
+            // (contains(text())); 2: contains it ignoring case (get_by_text).
+            const skip = new Set(['script', 'style', 'noscript', 'template']);
+            const walker = document.createTreeWalker(document.body || document.documentElement,
+                NodeFilter.SHOW_TEXT, { acceptNode: (n) =>
+                    n.parentElement && !skip.has(n.parentElement.localName)
+                        ? NodeFilter.FILTER_ACCEPT : NodeFilter.FILTER_REJECT });
+            let best = null, bestRank = 3;
+            for (let n = walker.nextNode(); n; n = walker.nextNode()) {
+                if (n.data.length < needle.length) continue;
+                const norm = n.data.replace(/\s+/g, ' ').trim();
+                const normLower = norm.toLowerCase();
+                const rank = normLower === lower ? 0 : norm.includes(needle) ? 1 : normLower.includes(lower) ? 2 : 3;
+                if (rank < bestRank && visible(n)) {
+                    best = n;
+                    bestRank = rank;
+                    if (rank === 0) break;
+                }
+            }
+            if (!best) {
+                textState.positions.set(needle, { miss: true, generation: textState.generation });
+                return { found: false, cached: false };
+            }
+            const strategy = ['exact text', 'text', 'text ignoring case'][bestRank];
+            textState.positions.set(needle, { node: new WeakRef(best), strategy });
+            return reveal(best, strategy, false);
+        },
+
+        dropdownOptions(xpath) {
+            const select = byXPath(xpath);
+            if (!select) return null;
+            return {
+                options: Array.from(select.options || []).map(opt => ({ text: opt.text, value: opt.value, index: opt.index })),
+                id: select.id,
+                name: select.name
+            };
+        },
+
+        findDropdown(xpath) {
+            try {
+                const select = byXPath(xpath);
+                if (!select) return null;
+                if (select.tagName.toLowerCase() !== 'select')
+                    return { error: `Found element but it's a ${select.tagName}, not a SELECT`, found: false };
+                return {
+                    id: select.id,
+                    name: select.name,
+                    found: true,
+                    tagName: select.tagName,
+                    optionCount: select.options.length,
+                    currentValue: select.value
+                };
+            } catch (e) {
+                return { error: e.toString(), found: false };
+            }
+        },
+
+        // select is the element itself (see PageHelpers::call_on). Fires
+        // change as a user selection would; false if no option has value.
+        selectOption(select, value) {
+            const index = Array.from(select.options || []).findIndex(opt => opt.value === value);
+            if (index < 0) return false;
+            select.selectedIndex = index;
+            select.dispatchEvent(new Event('change', { bubbles: true }));
+            return true;
+        },
+
+        clickSelector(selector) {
+            const el = document.querySelector(selector);
+            if (el) el.click();
+            return !!el;
+        }
+    };
+})();
+)js";
+    return source;
+}
+
+// "__agent.fn(arg, ...)" with the arguments as JSON literals.
+inline std::string page_helper_expression(const std::string &function, const nlohmann::json &args = nlohmann::json::array()) {
+    std::string expression = "__agent." + function + "(";
+    for (size_t i = 0; i < args.size(); i++) {
+        if (i) expression += ", ";
+        expression += args[i].dump();
+    }
+    return expression + ")";
+}
+
+// Runs the bundle in an isolated world of its own, so page scripts can
+// neither see nor replace it (the DOM is shared; JS globals are not). For
+// CDP clients:
+//
+//   on connect:  send install_command()  (every later document and frame)
+//   events:      on_event(msg) for Page.frameNavigated and the
+//                Runtime.executionContext* events (Runtime.enable needed)
+//   a call:      send call("scrollPage", {1, nullptr})
+//   on a node:   send call_on(objectId, "selectOption", {"b"}, helper_world)
+//
+// install_command() only covers documents created after it; until the world's
+// context for the main frame has been seen, call() falls back to evaluating
+// the bundle plus the call in the main world, so nothing breaks, it is just
+// the old cost.
+class PageHelpers {
+public:
+    explicit PageHelpers(std::string world = "agent-helpers") : world_(std::move(world)) {}
+
+    nlohmann::json install_command() const {
+        return {{"method", "Page.addScriptToEvaluateOnNewDocument"},
+                {"params", {{"source", page_helpers_source()}, {"worldName", world_}}}};
+    }
+
+    void on_event(const nlohmann::json &msg) {
+        const std::string method = msg.value("method", "");
+        if (!msg.contains("params")) return;
+        const nlohmann::json &params = msg["params"];
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (method == "Page.frameNavigated") {
+            const nlohmann::json &frame = params["frame"];
+            if (!frame.contains("parentId")) main_frame_ = frame.value("id", main_frame_);
+        } else if (method == "Runtime.executionContextCreated") {
+            const nlohmann::json &context = params["context"];
+            if (context.value("name", "") != world_ || !context.contains("auxData")) return;
+            contexts_[context["auxData"].value("frameId", "")] = context.value("id", 0);
+        } else if (method == "Runtime.executionContextDestroyed") {
+            int id = params.value("executionContextId", 0);
+            for (auto it = contexts_.begin(); it != contexts_.end();) {
+                it = it->second == id ? contexts_.erase(it) : std::next(it);
+            }
+        } else if (method == "Runtime.executionContextsCleared") {
+            contexts_.clear();
+        }
+    }
+
+    // Context of the helper world in the main frame, 0 while unknown.
+    int context_id() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = contexts_.find(main_frame_);
+        if (it != contexts_.end()) return it->second;
+        // Main frame not seen navigating yet: a single world context is it.
+        return contexts_.size() == 1 && main_frame_.empty() ? contexts_.begin()->second : 0;
+    }
+
+    // A Runtime.evaluate command ({"method", "params"}) calling function.
+    nlohmann::json call(const std::string &function, const nlohmann::json &args = nlohmann::json::array()) {
+        nlohmann::json params = {{"expression", page_helper_expression(function, args)},
+                                 {"returnByValue", true},
+                                 {"awaitPromise", true}};
+        if (int context = context_id()) {
+            params["contextId"] = context;
+            std::lock_guard<std::mutex> lock(mutex_);
+            short_calls_++;
+        } else {
+            params["expression"] = page_helpers_source() + params["expression"].get<std::string>();
+            std::lock_guard<std::mutex> lock(mutex_);
+            full_calls_++;
+        }
+        return {{"method", "Runtime.evaluate"}, {"params", params}};
+    }
+
+    // A Runtime.callFunctionOn command passing the remote object as the
+    // function's first argument. helper_world says whether the object was
+    // resolved in the helper world (DOM.resolveNode with executionContextId
+    // context_id()); a main-world object gets the bundle with the call, like
+    // call() before the world is known.
+    nlohmann::json call_on(const std::string &object_id, const std::string &function,
+                           const nlohmann::json &args, bool helper_world) {
+        std::string declaration = "function(...args) { ";
+        if (!helper_world) declaration += page_helpers_source();
+        declaration += "return __agent." + function + "(this, ...args); }";
+        nlohmann::json arguments = nlohmann::json::array();
+        for (const auto &arg : args) arguments.push_back({{"value", arg}});
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            (helper_world ? short_calls_ : full_calls_)++;
+        }
+        return {{"method", "Runtime.callFunctionOn"},
+                {"params", {{"objectId", object_id},
+                            {"functionDeclaration", declaration},
+                            {"arguments", arguments},
+                            {"returnByValue", true},
+                            {"awaitPromise", true}}}};
+    }
+
+    size_t short_calls() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return short_calls_;
+    }
+
+    size_t full_calls() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return full_calls_;
+    }
+
+private:
+    std::string world_;
+    mutable std::mutex mutex_;
+    std::string main_frame_;
+    std::map<std::string, int> contexts_;  // frameId -> helper world context
+    size_t short_calls_ = 0, full_calls_ = 0;
+};
+
+// For Page/Frame::evaluate based callers, which cannot pick a world: calls
+// the helper in the page's main world, installing the bundle on the first
+// call in each document (a ReferenceError for __agent).
+template <typename Target, typename... Args>
+auto evaluate_page_helper(Target &target, const std::string &call, Args &&...args) {
+    try {
+        return target->evaluate(call, args...).get();
+    } catch (const std::exception &e) {
+        if (std::string(e.what()).find("__agent") == std::string::npos) throw;
+        target->evaluate(page_helpers_source()).get();
+        return target->evaluate(call, args...).get();
+    }
+}
@@ -0,0 +1,179 @@
+// pagestate.hpp
+
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <charconv>
+
+// Serializes the interactive-element list for the model as a delta against
+// the previous step instead of the whole page:
+//
+//   @3 +1 -1 ~1 =42
+//   +[57]<button id="save">Save
+//   -[12]
+//   ~[7]<a href="/inbox">Inbox (3)
+//
+// The header is the step number, counts of added/removed/changed elements and
+// the total now indexed. The first step (or a step where more than half the
+// list changed) is sent in full as "@N full" followed by "[i]..." lines.
+// Indices are stable across steps, so "-[12]" means the element the model saw
+// as [12] is gone, and unchanged elements are never repeated.
+class PageStateEncoder {
+public:
+    // Elements keyed by a stable index, e.g. DomMirror indices.
+    std::string encode(const std::map<int, std::string> &elements) {
+        std::vector<int> added, removed, changed;
+        auto prev = previous_.begin();
+        auto cur = elements.begin();
+        // Both maps are ordered by index, so one merge pass finds the delta.
+        while (prev != previous_.end() || cur != elements.end()) {
+            if (cur == elements.end() || (prev != previous_.end() && prev->first < cur->first)) {
+                removed.push_back(prev->first);
+                ++prev;
+            } else if (prev == previous_.end() || cur->first < prev->first) {
+                added.push_back(cur->first);
+                ++cur;
+            } else {
+                if (prev->second != cur->second) changed.push_back(cur->first);
+                ++prev;
+                ++cur;
+            }
+        }
+        previous_ = elements;
+        return emit(added, removed, changed);
+    }
+
+    // Incremental form for producers that already know what changed (see
+    // DomMirror::take_delta); describe(index) returns the element's line.
+    std::string encode_delta(const std::vector<int> &added, const std::vector<int> &removed,
+                             const std::vector<int> &changed, const std::function<std::string(int)> &describe) {
+        for (int index : removed) previous_.erase(index);
+        for (int index : added) previous_[index] = describe(index);
+        for (int index : changed) previous_[index] = describe(index);
+        return emit(added, removed, changed);
+    }
+
+    // For producers without stable ids (the line scanner in 18): an element
+    // whose text is identical to one in the previous step keeps that index,
+    // everything else gets a fresh one.
+    std::map<int, std::string> stabilize(const std::vector<std::string> &elements) {
+        std::unordered_multimap<std::string, int> by_text;
+        for (const auto &[index, text] : previous_) by_text.emplace(text, index);
+
+        std::map<int, std::string> result;
+        for (const auto &text : elements) {
+            auto it = by_text.find(text);
+            if (it != by_text.end()) {
+                result[it->second] = text;
+                by_text.erase(it);
+            } else {
+                result[next_index()] = text;
+            }
+        }
+        return result;
+    }
+
+    // Persist the last step so one-shot clients can diff across runs. One
+    // "index<TAB>text" line per element; tabs, newlines and backslashes in
+    // the text (attribute values can hold them) are escaped.
+    void save(const std::string &path) const {
+        std::ofstream out(path);
+        out << step_ << " " << max_index_ << "\n";
+        for (const auto &[index, text] : previous_) out << index << "\t" << escape(text) << "\n";
+    }
+
+    // Lines that do not parse are skipped rather than failing the load.
+    bool load(const std::string &path) {
+        std::ifstream in(path);
+        if (!(in >> step_ >> max_index_)) return false;
+        std::string line;
+        std::getline(in, line);
+        previous_.clear();
+        while (std::getline(in, line)) {
+            size_t tab = line.find('\t');
+            if (tab == std::string::npos) continue;
+            int index = 0;
+            auto [end, ec] = std::from_chars(line.data(), line.data() + tab, index);
+            if (ec != std::errc() || end != line.data() + tab) continue;
+            previous_[index] = unescape(line.substr(tab + 1));
+        }
+        return true;
+    }
+
+    void reset() {
+        previous_.clear();
+        step_ = 0;
+        max_index_ = 0;
+    }
+
+    int step() const { return step_; }
+
+private:
+    std::map<int, std::string> previous_;
+    int step_ = 0;
+    int max_index_ = 0;
+
+    static std::string escape(const std::string &text) {
+        std::string out;
+        out.reserve(text.size());
+        for (char c : text) {
+            switch (c) {
+                case '\\': out += "\\\\"; break;
+                case '\t': out += "\\t"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                default: out += c;
+            }
+        }
+        return out;
+    }
+
+    static std::string unescape(const std::string &text) {
+        std::string out;
+        out.reserve(text.size());
+        for (size_t i = 0; i < text.size(); i++) {
+            if (text[i] != '\\' || i + 1 == text.size()) {
+                out += text[i];
+                continue;
+            }
+            switch (text[++i]) {
+                case 't': out += '\t'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case '\\': out += '\\'; break;
+                default: out += '\\'; out += text[i];
+            }
+        }
+        return out;
+    }
+
+    // Never hands out an index the model has already seen, even a removed one.
+    int next_index() {
+        if (!previous_.empty()) max_index_ = std::max(max_index_, previous_.rbegin()->first);
+        return ++max_index_;
+    }
+
+    std::string emit(const std::vector<int> &added, const std::vector<int> &removed, const std::vector<int> &changed) {
+        std::ostringstream out;
+        step_++;
+        size_t delta_size = added.size() + removed.size() + changed.size();
+        if (step_ == 1 || delta_size * 2 > previous_.size() + removed.size()) {
+            out << "@" << step_ << " full\n";
+            for (const auto &[index, text] : previous_) out << "[" << index << "]" << text << "\n";
+            return out.str();
+        }
+
+        out << "@" << step_ << " +" << added.size() << " -" << removed.size() << " ~" << changed.size()
+            << " =" << previous_.size() << "\n";
+        for (int index : added) out << "+[" << index << "]" << previous_[index] << "\n";
+        for (int index : removed) out << "-[" << index << "]\n";
+        for (int index : changed) out << "~[" << index << "]" << previous_[index] << "\n";
+        return out.str();
+    }
+};
@@ -0,0 +1,215 @@
+// pdfstream.hpp
+
+#pragma once
+#include <string>
+#include <fstream>
+#include <functional>
+#include <cstdio>
+#include <cctype>
+#include <nlohmann/json.hpp>
+
+// Page.printToPDF with transferMode ReturnAsStream, read back with IO.read in
+// fixed-size chunks and base64-decoded straight into the output file. Peak
+// memory is one chunk no matter how long the document is, where the default
+// transfer returns the whole PDF as one base64 string in the reply.
+//
+// PdfStreamExport is a small state machine so several tabs can export at once
+// on one event loop: send start(), then feed each reply's result to next()
+// and send what it returns until it returns null.
+//
+//   PdfStreamExport pdf("page.pdf");
+//   json cmd = pdf.start();                      // Page.printToPDF
+//   while (!cmd.is_null()) cmd = pdf.next(send(cmd["method"], cmd["params"]));
+//
+// The file is written as path + ".part" and renamed when the stream ends.
+// A failure once the stream is open still sends IO.close, so Chrome drops the
+// stream's data; failed() turns true after that reply.
+class PdfStreamExport {
+public:
+    explicit PdfStreamExport(std::string path, size_t chunk_size = 1 << 20)
+        : path_(std::move(path)), chunk_size_(chunk_size) {}
+
+    ~PdfStreamExport() {
+        if (out_.is_open()) {
+            out_.close();
+            std::remove(part_path().c_str());
+        }
+    }
+
+    // A4 portrait, matching the action's old page.pdf(name, "A4", false).
+    nlohmann::json start(bool print_background = false) {
+        state_ = State::Printing;
+        return {{"method", "Page.printToPDF"},
+                {"params", {{"transferMode", "ReturnAsStream"},
+                            {"paperWidth", 8.27},
+                            {"paperHeight", 11.69},
+                            {"printBackground", print_background}}}};
+    }
+
+    // result is the reply's "result" (null if the command failed). Returns the
+    // next {"method", "params"} to send, or null when finished.
+    nlohmann::json next(const nlohmann::json &result) {
+        if (state_ == State::Aborting) {
+            // The IO.close after a failure; its reply does not matter.
+            state_ = State::Failed;
+            return nullptr;
+        }
+        if (!result.is_object()) return fail("CDP error during " + state_name());
+
+        switch (state_) {
+            case State::Printing: {
+                handle_ = result.value("stream", "");
+                if (handle_.empty()) return fail("Page.printToPDF returned no stream handle");
+                out_.open(part_path(), std::ios::binary | std::ios::trunc);
+                if (!out_) return fail("cannot open " + part_path());
+                state_ = State::Reading;
+                return read_command();
+            }
+            case State::Reading: {
+                const std::string &data = result["data"].get_ref<const std::string &>();
+                if (result.value("base64Encoded", false)) {
+                    decode(data);
+                } else {
+                    out_.write(data.data(), static_cast<std::streamsize>(data.size()));
+                    bytes_written_ += data.size();
+                }
+                if (!out_) return fail("write failed for " + part_path());
+                if (!result.value("eof", false)) return read_command();
+                state_ = State::Closing;
+                return {{"method", "IO.close"}, {"params", {{"handle", handle_}}}};
+            }
+            case State::Closing: {
+                out_.close();
+                if (std::rename(part_path().c_str(), path_.c_str()) != 0) return fail("cannot rename to " + path_);
+                state_ = State::Done;
+                return nullptr;
+            }
+            default:
+                return nullptr;
+        }
+    }
+
+    bool done() const { return state_ == State::Done; }
+    bool failed() const { return state_ == State::Failed; }
+    const std::string &error() const { return error_; }
+    const std::string &path() const { return path_; }
+    size_t bytes_written() const { return bytes_written_; }
+
+private:
+    enum class State { Idle, Printing, Reading, Closing, Aborting, Done, Failed };
+
+    std::string path_;
+    size_t chunk_size_;
+    State state_ = State::Idle;
+    std::string handle_;
+    std::ofstream out_;
+    size_t bytes_written_ = 0;
+    std::string error_;
+
+    // Base64 carried over between chunks: IO.read may split inside a quantum.
+    unsigned int bits_ = 0;
+    int bit_count_ = 0;
+
+    std::string part_path() const { return path_ + ".part"; }
+
+    nlohmann::json read_command() const {
+        return {{"method", "IO.read"}, {"params", {{"handle", handle_}, {"size", chunk_size_}}}};
+    }
+
+    std::string state_name() const {
+        switch (state_) {
+            case State::Printing: return "Page.printToPDF";
+            case State::Reading: return "IO.read";
+            case State::Closing: return "IO.close";
+            default: return "export";
+        }
+    }
+
+    nlohmann::json fail(const std::string &message) {
+        error_ = message;
+        if (out_.is_open()) {
+            out_.close();
+            std::remove(part_path().c_str());
+        }
+        if (!handle_.empty() && state_ != State::Closing) {
+            state_ = State::Aborting;
+            return {{"method", "IO.close"}, {"params", {{"handle", handle_}}}};
+        }
+        state_ = State::Failed;
+        return nullptr;
+    }
+
+    void decode(const std::string &data) {
+        char buf[4096];
+        size_t n = 0;
+        for (char c : data) {
+            int v = base64_value(static_cast<unsigned char>(c));
+            if (v < 0) continue;  // padding, whitespace
+            bits_ = (bits_ << 6) | static_cast<unsigned int>(v);
+            bit_count_ += 6;
+            if (bit_count_ >= 8) {
+                bit_count_ -= 8;
+                buf[n++] = static_cast<char>((bits_ >> bit_count_) & 0xFF);
+                if (n == sizeof(buf)) {
+                    out_.write(buf, static_cast<std::streamsize>(n));
+                    bytes_written_ += n;
+                    n = 0;
+                }
+            }
+        }
+        out_.write(buf, static_cast<std::streamsize>(n));
+        bytes_written_ += n;
+    }
+
+    static int base64_value(unsigned char c) {
+        if (c >= 'A' && c <= 'Z') return c - 'A';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+        if (c >= '0' && c <= '9') return c - '0' + 52;
+        if (c == '+') return 62;
+        if (c == '/') return 63;
+        return -1;
+    }
+};
+
+// Runs an export to completion over a blocking send(method, params) that
+// returns the reply's result; a send that throws counts as a failed command,
+// so the stream is still closed. Returns false and fills error on failure.
+inline bool export_pdf(const std::function<nlohmann::json(const std::string &, const nlohmann::json &)> &send,
+                       const std::string &path, std::string *error = nullptr) {
+    PdfStreamExport pdf(path);
+    nlohmann::json cmd = pdf.start();
+    while (!cmd.is_null()) {
+        nlohmann::json result;
+        try {
+            result = send(cmd["method"], cmd["params"]);
+        } catch (const std::exception &) {
+        }
+        cmd = pdf.next(result);
+    }
+    if (error) *error = pdf.error();
+    return pdf.done();
+}
+
+// "https://www.example.com/a/b/" -> "example-com-a-b.pdf" in one pass, for the
+// save-as-PDF action (previously two std::regex_replace calls).
+inline std::string pdf_filename_for_url(const std::string &url) {
+    size_t start = 0;
+    if (url.compare(0, 8, "https://") == 0) start = 8;
+    else if (url.compare(0, 7, "http://") == 0) start = 7;
+    if (start && url.compare(start, 4, "www.") == 0) start += 4;
+
+    std::string slug;
+    slug.reserve(url.size() - start + 4);
+    bool dash = false;
+    for (size_t i = start; i < url.size(); i++) {
+        unsigned char c = static_cast<unsigned char>(url[i]);
+        if (std::isalnum(c)) {
+            if (dash && !slug.empty()) slug += '-';
+            slug += static_cast<char>(std::tolower(c));
+            dash = false;
+        } else {
+            dash = true;
+        }
+    }
+    return slug + ".pdf";
+}
@@ -0,0 +1,209 @@
+// prefetch.hpp
+
+#pragma once
+#include <string>
+#include <optional>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <ostream>
+#include <nlohmann/json.hpp>
+
+// Captures the page state for the next step while the model is still
+// thinking about it, instead of starting extraction (outerHTML, the
+// flattened DOM, the interactive list) only once the model has answered.
+//
+// After an action, arm() starts a background capture as soon as the page
+// settles: the main frame is not loading and no DOM mutation or navigation
+// event has arrived for `quiet` (or `max_wait` has passed, for pages that never
+// go quiet). take() at the start of the next step returns that capture when
+// nothing changed since it began, waiting for one still in progress rather
+// than starting over; otherwise it returns nullopt and the caller captures
+// as before. A change during the model's turn re-arms the capture, up to
+// max_attempts per step, so a page that finishes rendering late still hits.
+//
+// Events are fed from the connection's thread with on_event(); capture runs
+// on the prefetcher's own thread and must be safe to call from there.
+template <typename State>
+class StatePrefetcher {
+public:
+    using Capture = std::function<State()>;
+
+    explicit StatePrefetcher(Capture capture,
+                             std::chrono::milliseconds quiet = std::chrono::milliseconds(300),
+                             std::chrono::milliseconds max_wait = std::chrono::seconds(5),
+                             int max_attempts = 3)
+        : capture_(std::move(capture)), quiet_(quiet), max_wait_(max_wait), max_attempts_(max_attempts),
+          worker_([this] { run(); }) {}
+
+    ~StatePrefetcher() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        worker_.join();
+    }
+
+    StatePrefetcher(const StatePrefetcher &) = delete;
+    StatePrefetcher &operator=(const StatePrefetcher &) = delete;
+
+    // An action has finished; the model's turn starts.
+    void arm() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            armed_ = true;
+            attempts_ = 0;
+            snapshot_.reset();
+            armed_at_ = last_activity_ = Clock::now();
+        }
+        cv_.notify_all();
+    }
+
+    // The next step starts; hands over the capture if it is still current.
+    std::optional<State> take() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        armed_ = false;
+        cv_.wait(lock, [this] { return !capturing_ || capture_generation_ != generation_; });
+        std::optional<State> state;
+        if (snapshot_ && snapshot_generation_ == generation_) {
+            state = std::move(snapshot_);
+            hits_++;
+        } else {
+            misses_++;
+        }
+        snapshot_.reset();
+        return state;
+    }
+
+    void on_event(const nlohmann::json &msg) {
+        const std::string method = msg.value("method", "");
+        if (method.empty()) return;
+        const nlohmann::json &params = msg.contains("params") ? msg["params"] : empty_object();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (method == "Page.frameNavigated") {
+                const nlohmann::json &frame = params["frame"];
+                if (frame.contains("parentId")) return;
+                main_frame_ = frame.value("id", main_frame_);
+                changed();
+            } else if (method == "Page.navigatedWithinDocument" || method == "DOM.documentUpdated" ||
+                       method == "DOM.childNodeInserted" || method == "DOM.childNodeRemoved" ||
+                       method == "DOM.attributeModified" || method == "DOM.attributeRemoved" ||
+                       method == "DOM.characterDataModified") {
+                changed();
+            } else if (method == "Page.frameStartedLoading" && is_main(params)) {
+                loading_ = true;
+                changed();
+            } else if ((method == "Page.frameStoppedLoading" && is_main(params)) || method == "Page.loadEventFired") {
+                loading_ = false;
+                last_activity_ = Clock::now();
+            } else {
+                return;
+            }
+        }
+        cv_.notify_all();
+    }
+
+    // The events fed so far were about another page (the current tab
+    // changed): nothing captured before now is current.
+    void invalidate() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            main_frame_.clear();
+            loading_ = false;
+            changed();
+        }
+        cv_.notify_all();
+    }
+
+    void print_stats(std::ostream &out) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out << "state prefetch: " << hits_ << " hits, " << misses_ << " misses, " << discarded_
+            << " captures discarded by page changes\n";
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Capture capture_;
+    std::chrono::milliseconds quiet_;
+    std::chrono::milliseconds max_wait_;
+    int max_attempts_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+    bool armed_ = false;
+    bool loading_ = false;
+    bool capturing_ = false;
+    int attempts_ = 0;
+    unsigned long generation_ = 0;           // bumped by every page change
+    unsigned long capture_generation_ = 0;   // generation the running capture started at
+    unsigned long snapshot_generation_ = 0;
+    std::optional<State> snapshot_;
+    std::string main_frame_;
+    Clock::time_point armed_at_, last_activity_;
+    size_t hits_ = 0, misses_ = 0, discarded_ = 0;
+
+    // Declared last: the thread starts in the constructor and uses the rest.
+    std::thread worker_;
+
+    static const nlohmann::json &empty_object() {
+        static const nlohmann::json empty = nlohmann::json::object();
+        return empty;
+    }
+
+    bool is_main(const nlohmann::json &params) const {
+        return main_frame_.empty() || params.value("frameId", "") == main_frame_;
+    }
+
+    void changed() {
+        generation_++;
+        last_activity_ = Clock::now();
+    }
+
+    bool wanted() const {
+        return armed_ && attempts_ < max_attempts_ && !(snapshot_ && snapshot_generation_ == generation_);
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            cv_.wait(lock, [this] { return stopping_ || wanted(); });
+            if (stopping_) return;
+
+            // Settle: quiet for `quiet_` and not loading, or max_wait_ since arm().
+            Clock::time_point deadline = armed_at_ + max_wait_;
+            while (!stopping_ && wanted() && Clock::now() < deadline) {
+                Clock::time_point quiet_at = last_activity_ + quiet_;
+                if (!loading_ && Clock::now() >= quiet_at) break;
+                cv_.wait_until(lock, loading_ ? deadline : std::min(quiet_at, deadline));
+            }
+            if (stopping_) return;
+            if (!wanted()) continue;
+
+            attempts_++;
+            capturing_ = true;
+            capture_generation_ = generation_;
+            lock.unlock();
+            std::optional<State> state;
+            try {
+                state = capture_();
+            } catch (...) {
+                // Leave it to the synchronous capture in the next step.
+            }
+            lock.lock();
+            capturing_ = false;
+            if (state && capture_generation_ == generation_) {
+                snapshot_ = std::move(state);
+                snapshot_generation_ = capture_generation_;
+            } else if (state) {
+                discarded_++;
+            }
+            cv_.notify_all();
+        }
+    }
+};
@@ -0,0 +1,450 @@
+// responsecache.hpp
+
+#pragma once
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cctype>
+#include <list>
+#include <unordered_map>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <nlohmann/json.hpp>
+
+// Disk-backed response cache fed through Fetch.requestPaused.
+//
+// Request stage:  lookup(url) hit  -> Fetch.fulfillRequest with the stored body
+//                 miss             -> Fetch.continueRequest
+// Response stage: cacheable 200    -> Fetch.getResponseBody, then store()
+//
+// Bodies are kept base64-encoded (the form fulfillRequest wants) under
+// <dir>/blobs/<fnv64 of body>-<length>, so identical assets served from
+// different URLs share one file. The hash is not collision-proof: a body is
+// only shared after comparing it with the stored one, and a blob whose
+// length no longer matches its entry is not served. <dir>/index.json maps
+// URL -> blob + status + headers + freshness and is reloaded on the next
+// run, which is what makes the cache shared across runs; one ResponseCache
+// per process serves every tab/session on the connection.
+//
+// Only responses with an explicit freshness lifetime (s-maxage, max-age or
+// Expires - Date, less Age) are stored, and an entry past it is dropped and
+// fetched again rather than revalidated. private, no-cache and Vary on
+// anything but Accept-Encoding are never stored: the cache outlives the run
+// and has no request headers to match a variant against.
+class ResponseCache {
+public:
+    struct Entry {
+        std::string blob;
+        int status = 200;
+        nlohmann::json headers = nlohmann::json::array();
+        uint64_t size = 0;
+        int64_t stored_at = 0;  // unix seconds
+        int64_t lifetime = 0;   // seconds fresh after stored_at
+        std::list<std::string>::iterator lru_pos;
+    };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t stores = 0;
+        uint64_t evictions = 0;
+        uint64_t expired = 0;
+        uint64_t bytes_served = 0;
+
+        double hit_rate() const {
+            uint64_t total = hits + misses;
+            return total ? static_cast<double>(hits) / total : 0.0;
+        }
+    };
+
+    // cache_documents=false keeps HTML out of the cache so pages stay fresh
+    // while their static assets are served locally.
+    explicit ResponseCache(const std::string &dir, uint64_t max_bytes = 256ull << 20,
+                           bool cache_documents = false)
+        : dir_(dir), max_bytes_(max_bytes), cache_documents_(cache_documents) {
+        std::filesystem::create_directories(std::filesystem::path(dir_) / "blobs");
+        load();
+    }
+
+    ~ResponseCache() {
+        try {
+            save();
+        } catch (const std::exception &e) {
+            // index.json keeps its previous contents.
+            std::cerr << "response cache: index not saved: " << e.what() << "\n";
+        }
+    }
+
+    bool is_cacheable_type(const std::string &resource_type) const {
+        if (resource_type == "Document") return cache_documents_;
+        return resource_type == "Script" || resource_type == "Stylesheet" ||
+               resource_type == "Image" || resource_type == "Font" || resource_type == "Media";
+    }
+
+    // Fetch.enable patterns: pause cacheable types once before the request is
+    // sent (to serve hits) and once after headers arrive (to store misses).
+    nlohmann::json fetch_patterns() const {
+        nlohmann::json patterns = nlohmann::json::array();
+        std::vector<std::string> types = {"Script", "Stylesheet", "Image", "Font", "Media"};
+        if (cache_documents_) types.push_back("Document");
+        for (const auto &type : types) {
+            patterns.push_back({{"urlPattern", "*"}, {"resourceType", type}, {"requestStage", "Request"}});
+            patterns.push_back({{"urlPattern", "*"}, {"resourceType", type}, {"requestStage", "Response"}});
+        }
+        return patterns;
+    }
+
+    // Builds the Fetch.fulfillRequest params for a hit, or returns null on miss.
+    nlohmann::json lookup(const std::string &url, const std::string &request_id) {
+        auto it = entries_.find(url);
+        if (it == entries_.end()) {
+            stats_.misses++;
+            return nullptr;
+        }
+
+        if (now() >= it->second.stored_at + it->second.lifetime) {
+            erase_entry(it);
+            stats_.expired++;
+            stats_.misses++;
+            return nullptr;
+        }
+
+        std::string body;
+        if (!read_file(blob_path(it->second.blob), body) || body.size() != it->second.size) {
+            // Blob vanished from disk or is not the one stored; forget the
+            // entry and treat as a miss.
+            erase_entry(it);
+            stats_.misses++;
+            return nullptr;
+        }
+
+        lru_.splice(lru_.begin(), lru_, it->second.lru_pos);
+        stats_.hits++;
+        stats_.bytes_served += body.size();
+        return {{"requestId", request_id},
+                {"responseCode", it->second.status},
+                {"responseHeaders", it->second.headers},
+                {"body", std::move(body)}};
+    }
+
+    // Decide how to answer a Fetch.requestPaused event; returns {"method", "params"}
+    // for the reply. A Fetch.getResponseBody reply must be routed back through
+    // on_response_body() with the same requestId once its result arrives.
+    nlohmann::json on_request_paused(const nlohmann::json &paused) {
+        std::string request_id = paused["requestId"];
+        std::string url = paused["request"].value("url", "");
+        nlohmann::json cont = {{"method", "Fetch.continueRequest"}, {"params", {{"requestId", request_id}}}};
+
+        bool at_response = paused.contains("responseStatusCode") || paused.contains("responseErrorReason");
+        if (at_response) {
+            if (!is_cacheable_type(paused.value("resourceType", "")) || !is_cacheable_response(paused)) return cont;
+            nlohmann::json headers = paused.value("responseHeaders", nlohmann::json::array());
+            int64_t lifetime = freshness_lifetime(headers, now());
+            pending_[request_id] = {url, paused.value("responseStatusCode", 200), std::move(headers), lifetime};
+            return {{"method", "Fetch.getResponseBody"}, {"params", {{"requestId", request_id}}}};
+        }
+
+        if (!is_cacheable_type(paused.value("resourceType", ""))) return cont;
+        nlohmann::json hit = lookup(url, request_id);
+        if (hit.is_null()) return cont;
+        return {{"method", "Fetch.fulfillRequest"}, {"params", std::move(hit)}};
+    }
+
+    // result is the Fetch.getResponseBody result (null if it failed).
+    nlohmann::json on_response_body(const std::string &request_id, const nlohmann::json &result) {
+        auto it = pending_.find(request_id);
+        if (it != pending_.end()) {
+            if (result.is_object() && result.contains("body")) {
+                store(it->second.url, it->second.status, it->second.headers,
+                      result["body"], result.value("base64Encoded", false), it->second.lifetime);
+            }
+            pending_.erase(it);
+        }
+        return {{"method", "Fetch.continueRequest"}, {"params", {{"requestId", request_id}}}};
+    }
+
+    // Only plain 200 GETs that say for how long they stay fresh are worth
+    // keeping.
+    static bool is_cacheable_response(const nlohmann::json &paused) {
+        if (paused.value("responseStatusCode", 0) != 200) return false;
+        if (paused["request"].value("method", "GET") != "GET") return false;
+        return freshness_lifetime(paused.value("responseHeaders", nlohmann::json::array()), now()) > 0;
+    }
+
+    // Seconds a response with these headers, received at now, stays fresh;
+    // 0 if it must not be stored at all (see the class comment).
+    static int64_t freshness_lifetime(const nlohmann::json &headers, int64_t now) {
+        int64_t max_age = -1, s_maxage = -1, age = 0, date = -1, expires = -1;
+        bool has_expires = false;
+        for (const auto &h : headers) {
+            std::string name = lower(h.value("name", ""));
+            std::string value = lower(h.value("value", ""));
+            if (name == "set-cookie") return 0;
+            if (name == "vary") {
+                for (const auto &field : split_list(value))
+                    if (field != "accept-encoding") return 0;
+            } else if (name == "cache-control") {
+                for (const auto &directive : split_list(value)) {
+                    std::string key = directive.substr(0, directive.find('='));
+                    if (key == "no-store" || key == "no-cache" || key == "private") return 0;
+                    if (key == "max-age") max_age = directive_seconds(directive);
+                    if (key == "s-maxage") s_maxage = directive_seconds(directive);
+                }
+            } else if (name == "age") {
+                age = std::max<int64_t>(0, std::atoll(value.c_str()));
+            } else if (name == "date") {
+                date = http_date(h.value("value", ""));
+            } else if (name == "expires") {
+                has_expires = true;
+                expires = http_date(h.value("value", ""));
+            }
+        }
+        int64_t lifetime;
+        if (s_maxage >= 0) lifetime = s_maxage;
+        else if (max_age >= 0) lifetime = max_age;
+        else if (has_expires) lifetime = expires < 0 ? 0 : expires - (date < 0 ? now : date);  // bad date: expired
+        else return 0;  // no explicit lifetime; heuristics are not worth a stale replay
+        return std::max<int64_t>(0, lifetime - age);
+    }
+
+    // Store the Fetch.getResponseBody result for a response-stage pause; the
+    // entry is served for lifetime seconds from now.
+    void store(const std::string &url, int status, const nlohmann::json &headers,
+               const std::string &body, bool base64_encoded, int64_t lifetime) {
+        if (lifetime <= 0) return;
+        std::string encoded = base64_encoded ? body : base64_encode(body);
+        std::string blob = hex64(fnv1a(encoded)) + "-" + std::to_string(encoded.size());
+
+        auto existing = entries_.find(url);
+        if (existing != entries_.end()) erase_entry(existing);
+
+        auto shared = blob_refs_.find(blob);
+        if (shared != blob_refs_.end()) {
+            // Same hash and length: only share the file if it is the same body.
+            std::string stored;
+            if (!read_file(blob_path(blob), stored) || stored != encoded) return;
+        }
+        if (blob_refs_[blob]++ == 0) {
+            std::ofstream out(blob_path(blob), std::ios::binary);
+            out.write(encoded.data(), static_cast<std::streamsize>(encoded.size()));
+            total_bytes_ += encoded.size();
+        }
+
+        Entry entry;
+        entry.blob = blob;
+        entry.status = status;
+        entry.size = encoded.size();
+        entry.stored_at = now();
+        entry.lifetime = lifetime;
+        // getResponseBody hands back the decoded body, so the original
+        // encoding/length headers would make Chrome misread a replay.
+        for (const auto &h : headers) {
+            std::string name = lower(h.value("name", ""));
+            if (name != "content-encoding" && name != "content-length") entry.headers.push_back(h);
+        }
+        lru_.push_front(url);
+        entry.lru_pos = lru_.begin();
+        entries_[url] = std::move(entry);
+        stats_.stores++;
+
+        evict_to(max_bytes_);
+        if (++dirty_ % 32 == 0) {
+            try {
+                save();
+            } catch (const std::exception &e) {
+                std::cerr << "response cache: index not saved: " << e.what() << "\n";
+            }
+        }
+    }
+
+    // Writes index.json; throws std::filesystem::filesystem_error when the
+    // rename fails. Header bytes that are not valid UTF-8 are replaced.
+    void save() const {
+        nlohmann::json index = nlohmann::json::array();
+        // Oldest first, so load() can rebuild recency by pushing to the front.
+        for (auto it = lru_.rbegin(); it != lru_.rend(); ++it) {
+            const Entry &e = entries_.at(*it);
+            index.push_back({{"url", *it}, {"blob", e.blob}, {"status", e.status},
+                             {"headers", e.headers}, {"size", e.size},
+                             {"stored_at", e.stored_at}, {"lifetime", e.lifetime}});
+        }
+        std::string tmp = (std::filesystem::path(dir_) / "index.json.tmp").string();
+        std::ofstream(tmp) << index.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+        std::filesystem::rename(tmp, std::filesystem::path(dir_) / "index.json");
+    }
+
+    const Stats &stats() const { return stats_; }
+    uint64_t total_bytes() const { return total_bytes_; }
+    size_t size() const { return entries_.size(); }
+
+    void print_stats(std::ostream &os) const {
+        os << "📦 Cache: " << entries_.size() << " entries, " << total_bytes_ / 1024 << " KiB, "
+           << stats_.hits << " hits / " << stats_.misses << " misses (hit rate "
+           << static_cast<int>(stats_.hit_rate() * 100) << "%), " << stats_.evictions << " evicted, "
+           << stats_.expired << " expired, "
+           << stats_.bytes_served / 1024 << " KiB served locally\n";
+    }
+
+private:
+    struct PendingBody {
+        std::string url;
+        int status;
+        nlohmann::json headers;
+        int64_t lifetime;
+    };
+
+    std::string dir_;
+    uint64_t max_bytes_;
+    bool cache_documents_;
+    uint64_t total_bytes_ = 0;
+    uint64_t dirty_ = 0;
+    std::list<std::string> lru_;  // most recently used at the front
+    std::unordered_map<std::string, Entry> entries_;
+    std::unordered_map<std::string, int> blob_refs_;
+    std::unordered_map<std::string, PendingBody> pending_;
+    Stats stats_;
+
+    std::string blob_path(const std::string &blob) const {
+        return (std::filesystem::path(dir_) / "blobs" / blob).string();
+    }
+
+    void load() {
+        std::string text;
+        if (!read_file((std::filesystem::path(dir_) / "index.json").string(), text)) return;
+        nlohmann::json index = nlohmann::json::parse(text, nullptr, false);
+        if (!index.is_array()) return;
+
+        for (const auto &item : index) {
+            std::string blob = item.value("blob", "");
+            if (blob.empty() || !std::filesystem::exists(blob_path(blob))) continue;
+            Entry entry;
+            entry.blob = blob;
+            entry.status = item.value("status", 200);
+            entry.headers = item.value("headers", nlohmann::json::array());
+            entry.size = item.value("size", 0ull);
+            // Stale entries are kept until lookup() drops them, which also
+            // frees their blob; ones written before freshness was recorded
+            // have lifetime 0 and are stale.
+            entry.stored_at = item.value("stored_at", int64_t(0));
+            entry.lifetime = item.value("lifetime", int64_t(0));
+            std::string url = item.value("url", "");
+            lru_.push_front(url);
+            entry.lru_pos = lru_.begin();
+            if (blob_refs_[blob]++ == 0) total_bytes_ += entry.size;
+            entries_[url] = std::move(entry);
+        }
+        evict_to(max_bytes_);
+    }
+
+    void erase_entry(std::unordered_map<std::string, Entry>::iterator it) {
+        const std::string blob = it->second.blob;
+        lru_.erase(it->second.lru_pos);
+        if (--blob_refs_[blob] == 0) {
+            blob_refs_.erase(blob);
+            std::error_code ec;
+            std::filesystem::remove(blob_path(blob), ec);
+            total_bytes_ -= std::min(total_bytes_, it->second.size);
+        }
+        entries_.erase(it);
+    }
+
+    void evict_to(uint64_t limit) {
+        while (total_bytes_ > limit && !lru_.empty()) {
+            erase_entry(entries_.find(lru_.back()));
+            stats_.evictions++;
+        }
+    }
+
+    static bool read_file(const std::string &path, std::string &out) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return false;
+        std::ostringstream ss;
+        ss << in.rdbuf();
+        out = ss.str();
+        return true;
+    }
+
+    static int64_t now() { return static_cast<int64_t>(std::time(nullptr)); }
+
+    // Comma-separated header list, trimmed, empty items dropped.
+    static std::vector<std::string> split_list(const std::string &value) {
+        std::vector<std::string> items;
+        std::stringstream ss(value);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            size_t b = item.find_first_not_of(" \t"), e = item.find_last_not_of(" \t");
+            if (b != std::string::npos) items.push_back(item.substr(b, e - b + 1));
+        }
+        return items;
+    }
+
+    // "max-age=N" -> N; a malformed value counts as 0, i.e. already stale.
+    static int64_t directive_seconds(const std::string &directive) {
+        size_t eq = directive.find('=');
+        if (eq == std::string::npos) return 0;
+        std::string value = directive.substr(eq + 1);
+        value.erase(std::remove(value.begin(), value.end(), '"'), value.end());
+        if (value.empty() || !std::all_of(value.begin(), value.end(), [](unsigned char c) { return std::isdigit(c); })) return 0;
+        return std::atoll(value.c_str());
+    }
+
+    // IMF-fixdate ("Sun, 06 Nov 1994 08:49:37 GMT") -> unix seconds, -1 if
+    // it does not parse (RFC 9111 treats such an Expires as already past).
+    static int64_t http_date(const std::string &value) {
+        std::tm tm{};
+        std::istringstream in(value);
+        in >> std::get_time(&tm, "%a, %d %b %Y %H:%M:%S");
+        if (in.fail()) return -1;
+        return static_cast<int64_t>(timegm(&tm));
+    }
+
+    static std::string lower(std::string s) {
+        for (auto &c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        return s;
+    }
+
+    static uint64_t fnv1a(const std::string &data) {
+        uint64_t h = 1469598103934665603ull;
+        for (unsigned char c : data) {
+            h ^= c;
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    static std::string hex64(uint64_t v) {
+        char buf[17];
+        std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(v));
+        return buf;
+    }
+
+    static std::string base64_encode(const std::string &in) {
+        static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string out;
+        out.reserve((in.size() + 2) / 3 * 4);
+        size_t i = 0;
+        for (; i + 2 < in.size(); i += 3) {
+            uint32_t n = (uint8_t(in[i]) << 16) | (uint8_t(in[i + 1]) << 8) | uint8_t(in[i + 2]);
+            out += table[(n >> 18) & 63];
+            out += table[(n >> 12) & 63];
+            out += table[(n >> 6) & 63];
+            out += table[n & 63];
+        }
+        if (i < in.size()) {
+            uint32_t n = uint8_t(in[i]) << 16;
+            if (i + 1 < in.size()) n |= uint8_t(in[i + 1]) << 8;
+            out += table[(n >> 18) & 63];
+            out += table[(n >> 12) & 63];
+            out += (i + 1 < in.size()) ? table[(n >> 6) & 63] : '=';
+            out += '=';
+        }
+        return out;
+    }
+};
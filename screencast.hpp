@@ -0,0 +1,406 @@
+// screencast.hpp
+
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cstdint>
+#include <cerrno>
+#include <csetjmp>
+#include <fcntl.h>
+#include <unistd.h>
+#include <jpeglib.h>
+#include <nlohmann/json.hpp>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Highest segment number already in dir, 0 if none.
+inline int screencast_last_segment(const std::string &dir) {
+    int last = 0;
+    std::error_code ec;
+    for (const auto &f : std::filesystem::directory_iterator(dir, ec)) {
+        std::string name = f.path().filename().string();
+        int n = 0;
+        if (std::sscanf(name.c_str(), "frames-%d.", &n) == 1) last = std::max(last, n);
+    }
+    return last;
+}
+
+// Records Page.startScreencast frames without slowing the CDP loop.
+//
+// on_frame() runs on the lws thread and does the minimum: it moves the
+// base64 frame into a bounded queue and returns the Page.screencastFrameAck to
+// send right away, so Chrome keeps producing frames. Worker threads decode the
+// JPEG (libjpeg DCT scaling does most of the shrink), box-filter it down to
+// max_width, re-encode it and append it to a segmented archive:
+//
+//   dir/frames-000001.bin   records: "SCF1" seq u32, timestamp_us u64,
+//                           width u16, height u16, size u32, JPEG bytes
+//   dir/frames-000001.idx   one "seq timestamp_us offset size width height" line per frame
+//
+// A new segment starts once segment_bytes is reached. Numbering continues
+// after the highest segment already in dir, and each segment is claimed with
+// O_EXCL, so a second run (or a second recorder) into the same directory adds
+// segments instead of overwriting them. When the workers fall behind, the
+// oldest queued frame is dropped, so the trace stays current and memory
+// stays bounded.
+class ScreencastRecorder {
+public:
+    struct Options {
+        int workers = 2;
+        size_t queue_capacity = 8;
+        int max_width = 640;
+        int jpeg_quality = 70;
+        size_t segment_bytes = 64 << 20;
+    };
+
+    struct Stats {
+        size_t received = 0;
+        size_t dropped = 0;
+        size_t written = 0;
+        size_t failed = 0;
+        size_t bytes_written = 0;
+    };
+
+    explicit ScreencastRecorder(std::string dir) : ScreencastRecorder(std::move(dir), Options()) {}
+
+    ScreencastRecorder(std::string dir, Options options) : dir_(std::move(dir)), options_(options) {
+        std::filesystem::create_directories(dir_);
+        segment_number_ = screencast_last_segment(dir_);
+        for (int i = 0; i < std::max(1, options_.workers); i++) workers_.emplace_back([this] { work(); });
+    }
+
+    ~ScreencastRecorder() { close(); }
+
+    // Params for Page.startScreencast.
+    nlohmann::json start_params() const {
+        return {{"format", "jpeg"}, {"quality", 80}, {"everyNthFrame", 1}};
+    }
+
+    // Page.screencastFrame params; the data string is moved out. Returns the
+    // {"method", "params"} of the ack to send immediately.
+    nlohmann::json on_frame(nlohmann::json &params) {
+        int session_id = params.value("sessionId", 0);
+        Frame frame;
+        frame.base64 = std::move(params["data"].get_ref<std::string &>());
+        frame.timestamp_us = static_cast<uint64_t>(params["metadata"].value("timestamp", 0.0) * 1e6);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            frame.seq = static_cast<uint32_t>(++stats_.received);
+            if (queue_.size() >= options_.queue_capacity) {
+                queue_.pop_front();
+                stats_.dropped++;
+            }
+            queue_.push_back(std::move(frame));
+        }
+        ready_.notify_one();
+        return {{"method", "Page.screencastFrameAck"}, {"params", {{"sessionId", session_id}}}};
+    }
+
+    // Drains the queue, stops the workers and closes the current segment.
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) return;
+            stopping_ = true;
+        }
+        ready_.notify_all();
+        for (auto &t : workers_) t.join();
+        workers_.clear();
+        std::lock_guard<std::mutex> lock(archive_mutex_);
+        segment_.close();
+        index_.close();
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    void print_stats(std::ostream &out) const {
+        Stats s = stats();
+        out << "Screencast: " << s.received << " frames received, " << s.written << " written ("
+            << s.bytes_written / 1024 << " KiB), " << s.dropped << " dropped, " << s.failed << " failed\n";
+    }
+
+private:
+    struct Frame {
+        uint32_t seq = 0;
+        uint64_t timestamp_us = 0;
+        std::string base64;
+    };
+
+    struct Image {
+        int width = 0;
+        int height = 0;
+        std::vector<unsigned char> rgb;
+    };
+
+    std::string dir_;
+    Options options_;
+    std::vector<std::thread> workers_;
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<Frame> queue_;
+    Stats stats_;
+    bool stopping_ = false;
+
+    std::mutex archive_mutex_;
+    std::ofstream segment_;
+    std::ofstream index_;
+    int segment_number_ = 0;
+    size_t segment_size_ = 0;
+
+    void work() {
+        while (true) {
+            Frame frame;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+                if (queue_.empty()) return;
+                frame = std::move(queue_.front());
+                queue_.pop_front();
+            }
+
+            std::vector<unsigned char> jpeg = base64_decode(frame.base64);
+            frame.base64.clear();
+            Image image;
+            std::vector<unsigned char> encoded;
+            bool ok = decode_jpeg(jpeg, options_.max_width, image);
+            if (ok) {
+                if (image.width > options_.max_width) image = box_downscale(image, options_.max_width);
+                ok = encode_jpeg(image, options_.jpeg_quality, encoded);
+            }
+
+            // Archive writes have their own lock so decoding stays parallel.
+            if (ok) append(frame, image.width, image.height, encoded);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (ok) {
+                stats_.written++;
+                stats_.bytes_written += encoded.size();
+            } else {
+                stats_.failed++;
+            }
+        }
+    }
+
+    void append(const Frame &frame, int width, int height, const std::vector<unsigned char> &jpeg) {
+        std::lock_guard<std::mutex> lock(archive_mutex_);
+        if (!segment_.is_open() || segment_size_ >= options_.segment_bytes) roll_segment();
+
+        unsigned char header[24];
+        std::memcpy(header, "SCF1", 4);
+        put_le(header + 4, frame.seq, 4);
+        put_le(header + 8, frame.timestamp_us, 8);
+        put_le(header + 16, static_cast<uint64_t>(width), 2);
+        put_le(header + 18, static_cast<uint64_t>(height), 2);
+        put_le(header + 20, jpeg.size(), 4);
+        segment_.write(reinterpret_cast<const char *>(header), sizeof(header));
+        segment_.write(reinterpret_cast<const char *>(jpeg.data()), static_cast<std::streamsize>(jpeg.size()));
+
+        index_ << frame.seq << " " << frame.timestamp_us << " " << segment_size_ + sizeof(header) << " "
+               << jpeg.size() << " " << width << " " << height << "\n";
+        segment_size_ += sizeof(header) + jpeg.size();
+    }
+
+    void roll_segment() {
+        segment_.close();
+        index_.close();
+        segment_size_ = 0;
+        // Another recorder may have taken the next number since we looked.
+        for (int attempt = 0; attempt < 1000; attempt++) {
+            char name[32];
+            std::snprintf(name, sizeof(name), "frames-%06d", ++segment_number_);
+            std::string base = dir_ + "/" + name;
+            int fd = ::open((base + ".bin").c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+            if (fd < 0) {
+                if (errno == EEXIST) continue;
+                return;  // frames are dropped until the next roll
+            }
+            ::close(fd);
+            segment_.open(base + ".bin", std::ios::binary | std::ios::app);
+            index_.open(base + ".idx", std::ios::trunc);
+            return;
+        }
+    }
+
+    static void put_le(unsigned char *out, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; i++) out[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+
+    static std::vector<unsigned char> base64_decode(const std::string &in) {
+        static const auto table = [] {
+            std::array<int8_t, 256> t;
+            t.fill(-1);
+            const char *chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            for (int i = 0; i < 64; i++) t[static_cast<unsigned char>(chars[i])] = static_cast<int8_t>(i);
+            return t;
+        }();
+        std::vector<unsigned char> out;
+        out.reserve(in.size() / 4 * 3);
+        unsigned int bits = 0;
+        int count = 0;
+        for (unsigned char c : in) {
+            int v = table[c];
+            if (v < 0) continue;
+            bits = (bits << 6) | static_cast<unsigned int>(v);
+            count += 6;
+            if (count >= 8) {
+                count -= 8;
+                out.push_back(static_cast<unsigned char>((bits >> count) & 0xFF));
+            }
+        }
+        return out;
+    }
+
+    // libjpeg reports errors through error_exit, which must not return.
+    struct JpegError {
+        jpeg_error_mgr mgr;
+        std::jmp_buf jump;
+    };
+
+    static void jpeg_error_exit(j_common_ptr cinfo) {
+        std::longjmp(reinterpret_cast<JpegError *>(cinfo->err)->jump, 1);
+    }
+
+    // Decodes to RGB, letting libjpeg scale by 1/2, 1/4 or 1/8 in the DCT while
+    // the result stays at least max_width wide.
+    static bool decode_jpeg(const std::vector<unsigned char> &data, int max_width, Image &image) {
+        if (data.empty()) return false;
+        jpeg_decompress_struct cinfo;
+        JpegError err;
+        cinfo.err = jpeg_std_error(&err.mgr);
+        err.mgr.error_exit = jpeg_error_exit;
+        if (setjmp(err.jump)) {
+            jpeg_destroy_decompress(&cinfo);
+            return false;
+        }
+        jpeg_create_decompress(&cinfo);
+        jpeg_mem_src(&cinfo, const_cast<unsigned char *>(data.data()), static_cast<unsigned long>(data.size()));
+        jpeg_read_header(&cinfo, TRUE);
+        cinfo.out_color_space = JCS_RGB;
+        cinfo.scale_num = 1;
+        cinfo.scale_denom = 1;
+        while (cinfo.scale_denom < 8 && static_cast<int>(cinfo.image_width / (cinfo.scale_denom * 2)) >= max_width) {
+            cinfo.scale_denom *= 2;
+        }
+        jpeg_start_decompress(&cinfo);
+
+        image.width = static_cast<int>(cinfo.output_width);
+        image.height = static_cast<int>(cinfo.output_height);
+        image.rgb.resize(static_cast<size_t>(image.width) * image.height * 3);
+        while (cinfo.output_scanline < cinfo.output_height) {
+            JSAMPROW row = image.rgb.data() + static_cast<size_t>(cinfo.output_scanline) * image.width * 3;
+            jpeg_read_scanlines(&cinfo, &row, 1);
+        }
+        jpeg_finish_decompress(&cinfo);
+        jpeg_destroy_decompress(&cinfo);
+        return true;
+    }
+
+    static bool encode_jpeg(const Image &image, int quality, std::vector<unsigned char> &out) {
+        jpeg_compress_struct cinfo;
+        JpegError err;
+        unsigned char *buffer = nullptr;
+        unsigned long size = 0;
+        cinfo.err = jpeg_std_error(&err.mgr);
+        err.mgr.error_exit = jpeg_error_exit;
+        if (setjmp(err.jump)) {
+            jpeg_destroy_compress(&cinfo);
+            std::free(buffer);
+            return false;
+        }
+        jpeg_create_compress(&cinfo);
+        jpeg_mem_dest(&cinfo, &buffer, &size);
+        cinfo.image_width = static_cast<JDIMENSION>(image.width);
+        cinfo.image_height = static_cast<JDIMENSION>(image.height);
+        cinfo.input_components = 3;
+        cinfo.in_color_space = JCS_RGB;
+        jpeg_set_defaults(&cinfo);
+        jpeg_set_quality(&cinfo, quality, TRUE);
+        jpeg_start_compress(&cinfo, TRUE);
+        while (cinfo.next_scanline < cinfo.image_height) {
+            JSAMPROW row = const_cast<unsigned char *>(image.rgb.data()) +
+                           static_cast<size_t>(cinfo.next_scanline) * image.width * 3;
+            jpeg_write_scanlines(&cinfo, &row, 1);
+        }
+        jpeg_finish_compress(&cinfo);
+        out.assign(buffer, buffer + size);
+        jpeg_destroy_compress(&cinfo);
+        std::free(buffer);
+        return true;
+    }
+
+    // Area-average resize to target_width (aspect preserved). Rows are first
+    // summed vertically into a 16-bit accumulator row, which the SSE2 path
+    // does 16 bytes at a time; the horizontal pass then averages spans. After
+    // DCT scaling the shrink is under 2x, far below the 257 rows that would
+    // overflow the accumulator.
+    static Image box_downscale(const Image &src, int target_width) {
+        Image dst;
+        dst.width = target_width;
+        dst.height = std::max(1, static_cast<int>(static_cast<int64_t>(src.height) * target_width / src.width));
+        dst.rgb.resize(static_cast<size_t>(dst.width) * dst.height * 3);
+
+        size_t row_bytes = static_cast<size_t>(src.width) * 3;
+        std::vector<uint16_t> acc(row_bytes);
+        std::vector<int> x0(dst.width + 1);
+        for (int x = 0; x <= dst.width; x++) x0[x] = static_cast<int>(static_cast<int64_t>(x) * src.width / dst.width);
+
+        for (int y = 0; y < dst.height; y++) {
+            int sy0 = static_cast<int>(static_cast<int64_t>(y) * src.height / dst.height);
+            int sy1 = std::max(sy0 + 1, static_cast<int>(static_cast<int64_t>(y + 1) * src.height / dst.height));
+            std::fill(acc.begin(), acc.end(), 0);
+            for (int sy = sy0; sy < sy1; sy++) {
+                add_row(acc.data(), src.rgb.data() + static_cast<size_t>(sy) * row_bytes, row_bytes);
+            }
+
+            unsigned char *out = dst.rgb.data() + static_cast<size_t>(y) * dst.width * 3;
+            int rows = sy1 - sy0;
+            for (int x = 0; x < dst.width; x++) {
+                int span = std::max(1, x0[x + 1] - x0[x]);
+                uint32_t sum[3] = {0, 0, 0};
+                for (int sx = x0[x]; sx < x0[x] + span; sx++) {
+                    sum[0] += acc[sx * 3];
+                    sum[1] += acc[sx * 3 + 1];
+                    sum[2] += acc[sx * 3 + 2];
+                }
+                uint32_t n = static_cast<uint32_t>(span * rows);
+                out[x * 3] = static_cast<unsigned char>(sum[0] / n);
+                out[x * 3 + 1] = static_cast<unsigned char>(sum[1] / n);
+                out[x * 3 + 2] = static_cast<unsigned char>(sum[2] / n);
+            }
+        }
+        return dst;
+    }
+
+    static void add_row(uint16_t *acc, const unsigned char *row, size_t n) {
+        size_t i = 0;
+#ifdef __SSE2__
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= n; i += 16) {
+            __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i));
+            __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + i));
+            __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + i + 8));
+            lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(px, zero));
+            hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(px, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(acc + i), lo);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(acc + i + 8), hi);
+        }
+#endif
+        for (; i < n; i++) acc[i] = static_cast<uint16_t>(acc[i] + row[i]);
+    }
+};
@@ -0,0 +1,222 @@
+// selectorgen.hpp
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <cctype>
+#include <algorithm>
+
+// XPath and CSS selectors for many elements in one walk of a DOM.getDocument
+// tree (nlohmann::json or CdpValue), instead of one walk-to-root per element.
+//
+// The walk keeps the current path in a single buffer: each stack entry
+// remembers the length of its parent's path, so a node's path is the
+// parent's prefix plus one step. The steps come from per-parent sibling
+// counters computed when the parent is expanded:
+//
+//   xpath: /html/body/div[2]/a           ([k] only when the tag repeats)
+//   css:   #login > button               nearest ancestor (or self) with a
+//                                        unique id, else
+//          html > body > div:nth-of-type(2) > a
+//
+// Id uniqueness is only known once the whole tree has been seen, so CSS is
+// resolved after the walk. Shadow roots and iframe documents start a new
+// path, as selectors cannot cross those boundaries.
+struct ElementSelectors {
+    int node_id = 0;
+    int backend_node_id = 0;
+    std::string xpath;
+    std::string css;
+};
+
+class SelectorGenerator {
+public:
+    // want(node) picks the elements to produce selectors for; results are in
+    // document order.
+    template <typename Json, typename Want>
+    std::vector<ElementSelectors> generate(const Json &root, Want want) {
+        std::vector<ElementSelectors> out;
+        std::vector<Pending> pending;
+        std::unordered_map<std::string, int> id_counts;
+
+        std::string xpath, css;
+        std::vector<Frame<Json>> stack = {{&root, 0, 0, "", "", -1}};
+        std::vector<Step> steps;
+
+        while (!stack.empty()) {
+            Frame<Json> frame = std::move(stack.back());
+            stack.pop_back();
+            const Json &node = *frame.node;
+
+            xpath.resize(frame.xpath_len);
+            css.resize(frame.css_len);
+            int anchor = frame.anchor;
+
+            bool element = node.value("nodeType", 0) == 1;
+            if (element) {
+                xpath.append("/").append(frame.xpath_step);
+                if (!css.empty()) css.append(" > ");
+                css.append(frame.css_step);
+
+                std::string id = attribute(node, "id");
+                if (!id.empty()) {
+                    id_counts[id]++;
+                    anchor = static_cast<int>(anchors_.size());
+                    anchors_.push_back({id, css.size(), frame.anchor});
+                }
+                if (want(node)) {
+                    pending.push_back({out.size(), frame.anchor, id.empty() ? -1 : anchor});
+                    ElementSelectors sel;
+                    sel.node_id = node.value("nodeId", 0);
+                    sel.backend_node_id = node.value("backendNodeId", 0);
+                    sel.xpath = xpath;
+                    sel.css = css;
+                    out.push_back(std::move(sel));
+                }
+            }
+
+            // Children continue this path; shadow roots and frame documents
+            // restart it. Pushed in reverse so they pop as children, shadow
+            // roots, contentDocument.
+            if (node.contains("contentDocument")) {
+                stack.push_back({&node["contentDocument"], 0, 0, "", "", -1});
+            }
+            if (node.contains("shadowRoots")) {
+                const auto &roots = node["shadowRoots"];
+                for (auto it = roots.end(); it != roots.begin();) {
+                    --it;
+                    stack.push_back({&*it, 0, 0, "", "", -1});
+                }
+            }
+            if (node.contains("children")) {
+                const auto &children = node["children"];
+                sibling_steps(children, steps);
+                size_t i = steps.size();
+                for (auto it = children.end(); it != children.begin();) {
+                    --it;
+                    --i;
+                    stack.push_back({&*it, xpath.size(), css.size(), std::move(steps[i].xpath),
+                                     std::move(steps[i].css), anchor});
+                }
+            }
+        }
+
+        // Ancestors with an id that repeats are skipped for the next one up.
+        for (const auto &p : pending) {
+            ElementSelectors &sel = out[p.index];
+            if (p.own_anchor >= 0 && id_counts[anchors_[p.own_anchor].id] == 1) {
+                sel.css = id_selector(anchors_[p.own_anchor].id);
+                continue;
+            }
+            for (int a = p.anchor; a >= 0; a = anchors_[a].parent) {
+                if (id_counts[anchors_[a].id] == 1) {
+                    sel.css = id_selector(anchors_[a].id) + sel.css.substr(anchors_[a].css_len);
+                    break;
+                }
+            }
+        }
+        anchors_.clear();
+        return out;
+    }
+
+private:
+    template <typename Json>
+    struct Frame {
+        const Json *node;
+        size_t xpath_len;
+        size_t css_len;
+        std::string xpath_step;
+        std::string css_step;
+        int anchor;  // innermost id-bearing ancestor or self, in anchors_
+    };
+
+    struct Step {
+        std::string xpath;
+        std::string css;
+    };
+
+    struct Pending {
+        size_t index;
+        int anchor;
+        int own_anchor;
+    };
+
+    // Id-bearing elements, each linked to the next one up its path.
+    struct Anchor {
+        std::string id;
+        size_t css_len;  // length of its css path, the part an id replaces
+        int parent;
+    };
+
+    std::vector<Anchor> anchors_;
+
+    template <typename Json>
+    static std::string tag_of(const Json &node) {
+        std::string tag = node.value("localName", "");
+        if (tag.empty()) {
+            tag = node.value("nodeName", "");
+            for (auto &c : tag) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        return tag;
+    }
+
+    template <typename Json>
+    static std::string attribute(const Json &node, std::string_view name) {
+        if (!node.contains("attributes")) return "";
+        const auto &attrs = node["attributes"];
+        for (size_t i = 0; i + 1 < attrs.size(); i += 2) {
+            if (attrs[i].template get<std::string>() == name) return attrs[i + 1].template get<std::string>();
+        }
+        return "";
+    }
+
+    // One step per child: counts of each tag among the element siblings
+    // decide whether a position is needed.
+    template <typename Children>
+    static void sibling_steps(const Children &children, std::vector<Step> &steps) {
+        steps.clear();
+        std::vector<std::pair<std::string, int>> totals;
+        std::vector<std::string> tags;
+        for (const auto &child : children) {
+            tags.push_back(child.value("nodeType", 0) == 1 ? tag_of(child) : std::string());
+            if (tags.back().empty()) continue;
+            auto it = std::find_if(totals.begin(), totals.end(), [&](const auto &t) { return t.first == tags.back(); });
+            if (it == totals.end()) totals.push_back({tags.back(), 1});
+            else it->second++;
+        }
+
+        std::vector<std::pair<std::string, int>> seen;
+        for (const auto &tag : tags) {
+            Step step;
+            if (!tag.empty()) {
+                int total = std::find_if(totals.begin(), totals.end(), [&](const auto &t) { return t.first == tag; })->second;
+                auto it = std::find_if(seen.begin(), seen.end(), [&](const auto &t) { return t.first == tag; });
+                int position = it == seen.end() ? (seen.push_back({tag, 1}), 1) : ++it->second;
+                step.xpath = tag;
+                step.css = tag;
+                if (total > 1) {
+                    step.xpath += "[" + std::to_string(position) + "]";
+                    step.css += ":nth-of-type(" + std::to_string(position) + ")";
+                }
+            }
+            steps.push_back(std::move(step));
+        }
+    }
+
+    static std::string id_selector(const std::string &id) {
+        bool ident = !id.empty() && (std::isalpha(static_cast<unsigned char>(id[0])) || id[0] == '_');
+        for (char c : id) {
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_') ident = false;
+        }
+        if (ident) return "#" + id;
+        std::string quoted = "[id=\"";
+        for (char c : id) {
+            if (c == '"' || c == '\\') quoted += '\\';
+            quoted += c;
+        }
+        return quoted + "\"]";
+    }
+};
@@ -0,0 +1,219 @@
+// steppipeline.hpp
+
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <nlohmann/json.hpp>
+
+// One CDP-level action of an agent step. next(results) is reply-driven like
+// DirectClick/PdfStreamExport: it is called with null first and returns a
+// batch (array of {"method", "params"}), then with the results of that batch,
+// until it returns null. Actions that fit in one batch use fixed().
+//
+// single_batch says the first batch is also the last, so what follows can be
+// sent before its replies. may_change_page marks actions after which the page
+// may be different (clicks, Enter): what follows waits for their replies.
+// A navigation the input event starts synchronously (a link, a form submit)
+// is reported before the reply to that event, so the fence has seen it by
+// then. One started later (a timer, a fetch then location.href) is not; the
+// guard also covers those through the load events, aborting the rest of the
+// step whenever the main frame starts loading.
+struct PipelinedAction {
+    std::string name;
+    std::function<nlohmann::json(const nlohmann::json &results)> next;
+    bool may_change_page = false;
+    bool single_batch = false;
+
+    static PipelinedAction fixed(std::string name, nlohmann::json commands, bool may_change_page = false) {
+        return {std::move(name),
+                [commands = std::move(commands)](const nlohmann::json &results) -> nlohmann::json {
+                    return results.is_null() ? commands : nlohmann::json();
+                },
+                may_change_page, true};
+    }
+};
+
+// Runs the actions of one step with their commands pipelined, instead of one
+// async hop per action. Actions that cannot change the page (typing,
+// scrolling, plain keys) go out back to back; an action marked
+// may_change_page is a fence, and the rest of the step follows as soon as its
+// replies are in.
+//
+// The remainder of the step is abandoned, without polling, when an event
+// shows the page changed under it: a main-frame navigation (including
+// same-document route changes and the main frame starting to load),
+// DOM.documentUpdated, or more than dom_change_limit node
+// insertions/removals since the step started. Commands already in flight
+// still have their replies consumed.
+//
+//   StepPipeline step(actions);
+//   for (auto &cmd : step.start(next_id)) send(cmd);
+//   on every reply:  for (auto &cmd : step.on_reply(msg, next_id)) send(cmd);
+//   on every event:  step.on_event(msg);
+//   until step.finished()
+class StepPipeline {
+public:
+    enum class Status { Pending, Running, Done, Failed, Skipped };
+
+    explicit StepPipeline(std::vector<PipelinedAction> actions, size_t dom_change_limit = 50)
+        : actions_(std::move(actions)), status_(actions_.size(), Status::Pending), dom_change_limit_(dom_change_limit) {}
+
+    // Page.getFrameTree's main frame id; learned from Page.frameNavigated
+    // otherwise. Until it is known, every frame's navigation request counts.
+    void set_main_frame(std::string frame_id) { main_frame_ = std::move(frame_id); }
+
+    // Commands to send now, with ids assigned from next_id.
+    nlohmann::json start(int &next_id) {
+        nlohmann::json out = nlohmann::json::array();
+        release(out, next_id);
+        return out;
+    }
+
+    // Feed every reply; returns the commands it unblocks. Replies that are
+    // not part of this step are ignored.
+    nlohmann::json on_reply(const nlohmann::json &msg, int &next_id) {
+        nlohmann::json out = nlohmann::json::array();
+        auto it = in_flight_.find(msg.value("id", -1));
+        if (it == in_flight_.end()) return out;
+        Batch &batch = batches_[it->second.first];
+        batch.results[it->second.second] = msg.contains("result") ? msg["result"] : nlohmann::json();
+        in_flight_.erase(it);
+        if (--batch.outstanding == 0) {
+            size_t action = batch.action;
+            nlohmann::json results = std::move(batch.results);
+            batches_.erase(action);
+            if (status_[action] == Status::Running) advance(action, results, out, next_id);
+        }
+        if (!aborted()) release(out, next_id);
+        return out;
+    }
+
+    // Feed every event; returns true if it aborted the step.
+    bool on_event(const nlohmann::json &msg) {
+        if (aborted() || finished()) return false;
+        const std::string method = msg.value("method", "");
+        const nlohmann::json &params = msg.contains("params") ? msg["params"] : empty_object();
+
+        if (method == "Page.frameNavigated") {
+            const nlohmann::json &frame = params["frame"];
+            if (frame.contains("parentId")) return false;
+            main_frame_ = frame.value("id", main_frame_);
+            return abort("navigated to " + frame.value("url", std::string()));
+        }
+        if (method == "Page.frameRequestedNavigation" || method == "Page.navigatedWithinDocument") {
+            std::string frame = params.value("frameId", "");
+            if (!main_frame_.empty() && frame != main_frame_) return false;
+            return abort(method == "Page.navigatedWithinDocument" ? "route changed to " + params.value("url", std::string())
+                                                                  : "navigation requested to " + params.value("url", std::string()));
+        }
+        if (method == "Page.frameStartedLoading") {
+            if (!main_frame_.empty() && params.value("frameId", "") != main_frame_) return false;
+            return abort("page started loading");
+        }
+        if (method == "DOM.documentUpdated") return abort("document replaced");
+        if (method == "DOM.childNodeInserted" || method == "DOM.childNodeRemoved") {
+            if (++dom_changes_ > dom_change_limit_)
+                return abort(std::to_string(dom_changes_) + " DOM nodes changed");
+        }
+        return false;
+    }
+
+    bool finished() const { return in_flight_.empty() && (aborted() || next_ == actions_.size()); }
+    bool aborted() const { return !abort_reason_.empty(); }
+    const std::string &abort_reason() const { return abort_reason_; }
+    Status status(size_t action) const { return status_[action]; }
+    const std::string &name(size_t action) const { return actions_[action].name; }
+    size_t size() const { return actions_.size(); }
+
+    size_t completed() const {
+        size_t n = 0;
+        for (Status s : status_) n += s == Status::Done;
+        return n;
+    }
+
+    // Round trips the step waited on, counting pipelined batches once.
+    int round_trips() const { return waits_; }
+
+private:
+    struct Batch {
+        size_t action;
+        nlohmann::json results;
+        size_t outstanding;
+    };
+
+    std::vector<PipelinedAction> actions_;
+    std::vector<Status> status_;
+    size_t dom_change_limit_;
+    size_t dom_changes_ = 0;
+    std::string main_frame_;
+    std::string abort_reason_;
+
+    size_t next_ = 0;                                        // first action not yet started
+    std::map<size_t, Batch> batches_;                        // action -> its batch in flight
+    std::map<int, std::pair<size_t, size_t>> in_flight_;     // command id -> (action, slot)
+    int waits_ = 0;
+
+    static const nlohmann::json &empty_object() {
+        static const nlohmann::json empty = nlohmann::json::object();
+        return empty;
+    }
+
+    // Starts actions in order until one has to be waited for: a fence, or an
+    // action that still has batches to come.
+    void release(nlohmann::json &out, int &next_id) {
+        while (next_ < actions_.size()) {
+            if (next_ > 0 && blocks(next_ - 1)) return;
+            size_t action = next_++;
+            status_[action] = Status::Running;
+            send(action, actions_[action].next(nullptr), out, next_id);
+        }
+    }
+
+    bool blocks(size_t action) const {
+        if (status_[action] != Status::Running) return false;
+        return actions_[action].may_change_page || !actions_[action].single_batch;
+    }
+
+    void advance(size_t action, const nlohmann::json &results, nlohmann::json &out, int &next_id) {
+        for (const auto &r : results) {
+            if (!r.is_object()) {
+                status_[action] = Status::Failed;
+                if (!aborted()) abort(actions_[action].name + " failed");
+                return;
+            }
+        }
+        nlohmann::json batch = actions_[action].next(results);
+        if (aborted() && !batch.is_null()) {
+            // Interrupted between batches: nothing more goes to the changed page.
+            status_[action] = Status::Skipped;
+            return;
+        }
+        send(action, batch, out, next_id);
+    }
+
+    void send(size_t action, const nlohmann::json &batch, nlohmann::json &out, int &next_id) {
+        if (!batch.is_array() || batch.empty()) {
+            status_[action] = Status::Done;
+            return;
+        }
+        if (in_flight_.empty()) waits_++;
+        Batch &b = batches_[action];
+        b = {action, nlohmann::json::array(), batch.size()};
+        for (size_t i = 0; i < batch.size(); i++) {
+            b.results.push_back(nullptr);
+            in_flight_[next_id] = {action, i};
+            out.push_back({{"id", next_id++}, {"method", batch[i]["method"]}, {"params", batch[i]["params"]}});
+        }
+    }
+
+    bool abort(std::string reason) {
+        abort_reason_ = std::move(reason);
+        for (size_t i = 0; i < actions_.size(); i++) {
+            if (status_[i] == Status::Pending) status_[i] = Status::Skipped;
+        }
+        next_ = actions_.size();
+        return true;
+    }
+};
@@ -0,0 +1,307 @@
+// tabpool.hpp
+
+#pragma once
+#include <string>
+#include <set>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <ostream>
+#include <algorithm>
+#include <nlohmann/json.hpp>
+
+// "scheme://host[:port]" of an http(s) url, "" for anything else (about:,
+// data:, chrome:, ...), which has no storage worth clearing.
+inline std::string url_origin(const std::string &url) {
+    size_t scheme = url.find("://");
+    if (scheme == std::string::npos) return "";
+    std::string name = url.substr(0, scheme);
+    if (name != "http" && name != "https") return "";
+    size_t end = url.find_first_of("/?#", scheme + 3);
+    return url.substr(0, end);
+}
+
+// The commands that return a used tab to a blank one: leave the page first,
+// so its scripts cannot write storage back, drop its history, clear the
+// storage of the given origins and undo every emulation override a task may
+// have set. Storage belongs to the browser context, not the tab, so origins
+// open in other tabs must not be cleared (see reset_tab()).
+inline nlohmann::json tab_reset_commands(const std::set<std::string> &origins) {
+    nlohmann::json batch = nlohmann::json::array();
+    auto add = [&](const char *method, nlohmann::json params = nlohmann::json::object()) {
+        batch.push_back({{"method", method}, {"params", std::move(params)}});
+    };
+    add("Page.navigate", {{"url", "about:blank"}});
+    add("Page.resetNavigationHistory");
+    for (const auto &origin : origins) add("Storage.clearDataForOrigin", {{"origin", origin}, {"storageTypes", "all"}});
+    add("Emulation.clearDeviceMetricsOverride");
+    add("Emulation.setUserAgentOverride", {{"userAgent", ""}});
+    add("Emulation.clearGeolocationOverride");
+    add("Emulation.setEmulatedMedia", {{"media", ""}, {"features", nlohmann::json::array()}});
+    add("Emulation.setTimezoneOverride", {{"timezoneId", ""}});
+    add("Emulation.setLocaleOverride");
+    add("Emulation.setTouchEmulationEnabled", {{"enabled", false}});
+    add("Emulation.setCPUThrottlingRate", {{"rate", 1}});
+    return batch;
+}
+
+// Resets the tab behind send (as for call_on_node()) with tab_reset_commands()
+// for every origin in its history. origin_in_use(origin) is asked right
+// before each origin is cleared, not once up front, so an origin another tab
+// has navigated to in the meantime keeps its storage. Returns false if the
+// tab could not be made blank and clean, in which case it should be closed
+// rather than reused. The Emulation.* resets are best effort: older browsers
+// lack some of them, and an override that was never set leaves nothing behind.
+inline bool reset_tab(const std::function<nlohmann::json(const std::string &, const nlohmann::json &)> &send,
+                      const std::function<bool(const std::string &origin)> &origin_in_use = nullptr) {
+    std::set<std::string> origins;
+    try {
+        nlohmann::json history = send("Page.getNavigationHistory", nlohmann::json::object());
+        for (const auto &entry : history.value("entries", nlohmann::json::array())) {
+            std::string origin = url_origin(entry.value("url", ""));
+            if (!origin.empty()) origins.insert(origin);
+        }
+    } catch (const std::exception &) {
+        return false;
+    }
+    for (const auto &cmd : tab_reset_commands(origins)) {
+        const std::string method = cmd["method"];
+        if (method == "Storage.clearDataForOrigin" && origin_in_use && origin_in_use(cmd["params"]["origin"])) continue;
+        try {
+            send(method, cmd["params"]);
+        } catch (const std::exception &) {
+            if (method.rfind("Emulation.", 0) != 0) return false;
+        }
+    }
+    return true;
+}
+
+// Tabs created ahead of time and reused between tasks, so opening a tab is
+// handing one out instead of waiting for a new target and renderer.
+//
+// A pool thread creates `size` idle tabs at start. Released tabs are reset
+// and put back while the pool holds fewer than `size` (idle plus waiting for
+// a reset); past that they are closed unreset, so a reset never runs for a
+// tab that is then thrown away. New tabs are only created again when fewer
+// than `min_idle` are left, so the tabs tasks give back are what refills the
+// pool. acquire() never waits for the pool thread; with no idle tab it
+// creates one itself, which is the old cost and shows as a cold acquire.
+//
+//   TabPool<Page> pool({create, reset, destroy}, 2);
+//   auto lease = pool.acquire();
+//   pool.first_command(lease);   // just before sending the tab its first command
+//   ...
+//   pool.release(lease.tab);     // instead of closing it
+//
+// The hooks run on the pool thread (and create on the caller of a cold
+// acquire) and may throw; a tab whose create or reset threw is not used.
+template <typename Tab>
+class TabPool {
+public:
+    struct Hooks {
+        std::function<Tab()> create;
+        std::function<bool(Tab &)> reset;  // false: destroy the tab instead
+        std::function<void(Tab &)> destroy;
+    };
+
+    struct Lease {
+        Tab tab;
+        bool warm = false;    // taken from the pool, not created on acquire
+        bool reused = false;  // served an earlier task
+        std::chrono::steady_clock::time_point requested_at;
+    };
+
+    TabPool(Hooks hooks, size_t size, size_t min_idle = 1)
+        : hooks_(std::move(hooks)), size_(size), min_idle_(std::min(min_idle, size)) {
+        worker_ = std::thread([this] { work(); });
+    }
+
+    ~TabPool() { close(); }
+
+    TabPool(const TabPool &) = delete;
+    TabPool &operator=(const TabPool &) = delete;
+
+    Lease acquire() {
+        Lease lease;
+        lease.requested_at = Clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            acquires_++;
+            if (!idle_.empty()) {
+                Idle idle = std::move(idle_.front());
+                idle_.pop_front();
+                lease.tab = std::move(idle.tab);
+                lease.warm = true;
+                lease.reused = idle.served;
+                warm_++;
+                reused_ += idle.served;
+            }
+        }
+        cv_.notify_one();  // refill
+        if (!lease.warm) {
+            lease.tab = hooks_.create();
+            std::lock_guard<std::mutex> lock(mutex_);
+            created_++;
+        }
+        return lease;
+    }
+
+    // Records the lease's time to first command: from acquire() to now.
+    void first_command(const Lease &lease) {
+        auto took = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - lease.requested_at);
+        std::lock_guard<std::mutex> lock(mutex_);
+        Latency &latency = lease.warm ? warm_latency_ : cold_latency_;
+        latency.count++;
+        latency.total += took;
+        latency.max = std::max(latency.max, took);
+    }
+
+    // Takes a tab back; it is reset on the pool thread, or closed here when
+    // the pool is full. Any tab of the browser can be released, not only
+    // leased ones.
+    void release(Tab tab) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!stopping_ && held() < size_) {
+                dirty_.push_back(std::move(tab));
+                cv_.notify_one();
+                return;
+            }
+        }
+        destroy(tab);
+    }
+
+    // Stops the pool thread after the resets in progress and closes the idle
+    // tabs. Released tabs still waiting for a reset are closed unreset.
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) return;
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        worker_.join();
+        for (auto &tab : dirty_) destroy(tab);
+        for (auto &idle : idle_) destroy(idle.tab);
+        dirty_.clear();
+        idle_.clear();
+    }
+
+    size_t idle() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return idle_.size();
+    }
+
+    void print_stats(std::ostream &out) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto avg_ms = [](const Latency &l) { return l.count ? l.total.count() / l.count / 1000.0 : 0.0; };
+        out << "tab pool: " << acquires_ << " acquires, " << warm_ << " warm, " << reused_ << " reused ("
+            << (acquires_ ? 100.0 * reused_ / acquires_ : 0.0) << "% reuse); first command after "
+            << avg_ms(warm_latency_) << " ms warm (max " << warm_latency_.max.count() / 1000.0 << "), " << avg_ms(cold_latency_)
+            << " ms cold (max " << cold_latency_.max.count() / 1000.0 << "); " << created_ << " created, " << resets_
+            << " resets, " << failed_resets_ << " failed, " << destroyed_ << " closed\n";
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Idle {
+        Tab tab;
+        bool served = false;
+    };
+
+    struct Latency {
+        size_t count = 0;
+        std::chrono::microseconds total{0}, max{0};
+    };
+
+    Hooks hooks_;
+    size_t size_, min_idle_;
+    bool filling_ = true;  // creating the initial `size` tabs
+    size_t resetting_ = 0;
+    std::thread worker_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Idle> idle_;
+    std::deque<Tab> dirty_;  // released, waiting for a reset
+    bool stopping_ = false;
+    size_t acquires_ = 0, warm_ = 0, reused_ = 0, created_ = 0, resets_ = 0, failed_resets_ = 0, destroyed_ = 0;
+    Latency warm_latency_, cold_latency_;
+
+    void destroy(Tab &tab) {
+        try {
+            hooks_.destroy(tab);
+        } catch (const std::exception &) {
+            // Already gone with its target.
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        destroyed_++;
+    }
+
+    // Tabs the pool owns, counting the one being reset.
+    size_t held() const { return idle_.size() + dirty_.size() + resetting_; }
+
+    bool needs_tab() {
+        if (filling_ && held() >= size_) filling_ = false;
+        return held() < (filling_ ? size_ : min_idle_);
+    }
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            cv_.wait(lock, [this] { return stopping_ || !dirty_.empty() || needs_tab(); });
+            if (stopping_) return;
+
+            if (!dirty_.empty()) {
+                Tab tab = std::move(dirty_.front());
+                dirty_.pop_front();
+                if (idle_.size() >= size_) {
+                    lock.unlock();
+                    destroy(tab);
+                    lock.lock();
+                    continue;
+                }
+                resetting_++;
+                lock.unlock();
+                bool ok = false;
+                try {
+                    ok = hooks_.reset(tab);
+                } catch (const std::exception &) {
+                }
+                lock.lock();
+                resetting_--;
+                resets_++;
+                failed_resets_ += !ok;
+                if (ok && idle_.size() < size_) {
+                    idle_.push_front({std::move(tab), true});  // handed out before fresh tabs
+                    continue;
+                }
+                lock.unlock();
+                destroy(tab);
+                lock.lock();
+                continue;
+            }
+
+            lock.unlock();
+            bool ok = false;
+            Tab tab;
+            try {
+                tab = hooks_.create();
+                ok = true;
+            } catch (const std::exception &) {
+            }
+            lock.lock();
+            if (!ok) {
+                // The browser refuses new targets; retry later rather than spin.
+                cv_.wait_for(lock, std::chrono::seconds(1), [this] { return stopping_ || !dirty_.empty(); });
+                continue;
+            }
+            created_++;
+            idle_.push_back({std::move(tab), false});
+        }
+    }
+};
@@ -0,0 +1,84 @@
+// transport.hpp
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <functional>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <nlohmann/json.hpp>
+
+// The WebSocket layer under a CDP client, so the protocol code does not care
+// whether frames go through libwebsockets, websocketpp or Boost.Beast.
+// Backends live in transport_lws.hpp, transport_wspp.hpp and
+// transport_beast.hpp; transportbench.cpp compares them on one workload, and
+// client 19 runs on LwsTransport.
+//
+// The model is single-threaded: send() queues or writes a text message,
+// poll() runs the backend's event loop for up to timeout_ms and hands every
+// complete message to the on_message handler. wake() is the one call other
+// threads may make.
+class CdpTransport {
+public:
+    using MessageHandler = std::function<void(std::string_view)>;
+
+    virtual ~CdpTransport() = default;
+
+    virtual const char *name() const = 0;
+
+    // Blocks until the WebSocket handshake completes or fails.
+    virtual bool connect(const std::string &host, int port, const std::string &path) = 0;
+
+    virtual void send(const std::string &text) = 0;
+
+    // Returns false once the connection has closed.
+    virtual bool poll(int timeout_ms) = 0;
+
+    // Makes a poll() blocked on another thread return early, so that thread
+    // can send what it was handed. Backends without one return at the latest
+    // when the timeout runs out.
+    virtual void wake() {}
+
+    virtual void close() = 0;
+
+    void on_message(MessageHandler handler) { handler_ = std::move(handler); }
+
+protected:
+    MessageHandler handler_;
+
+    void deliver(std::string_view message) {
+        if (handler_) handler_(message);
+    }
+};
+
+// Path part of the first page target's webSocketDebuggerUrl, via /json.
+inline std::string discover_page_path(const std::string &host, int port) {
+    namespace http = boost::beast::http;
+    using tcp = boost::asio::ip::tcp;
+
+    boost::asio::io_context ioc;
+    tcp::resolver resolver(ioc);
+    boost::beast::tcp_stream stream(ioc);
+    stream.connect(resolver.resolve(host, std::to_string(port)));
+
+    http::request<http::string_body> req{http::verb::get, "/json", 11};
+    req.set(http::field::host, host);
+    http::write(stream, req);
+
+    boost::beast::flat_buffer buffer;
+    http::response<http::string_body> res;
+    http::read(stream, buffer, res);
+    boost::beast::error_code ec;
+    stream.socket().shutdown(tcp::socket::shutdown_both, ec);
+
+    for (const auto &target : nlohmann::json::parse(res.body())) {
+        if (target.value("type", "") != "page") continue;
+        std::string url = target.value("webSocketDebuggerUrl", "");
+        size_t scheme = url.find("://");
+        size_t slash = url.find('/', scheme == std::string::npos ? 0 : scheme + 3);
+        if (slash != std::string::npos) return url.substr(slash);
+    }
+    return "";
+}
@@ -0,0 +1,99 @@
+// transport_beast.hpp
+
+#pragma once
+#include <string>
+#include <chrono>
+#include <boost/version.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include "transport.hpp"
+#include "deflatepolicy.hpp"
+
+// Boost.Beast backend: synchronous connect and writes, one outstanding
+// async_read driven by io_context::run_for in poll(). From Boost 1.77 Beast
+// can skip compression per message, so outbound messages below
+// DeflatePolicy::min_message_size go out uncompressed.
+class BeastTransport : public CdpTransport {
+public:
+    explicit BeastTransport(DeflatePolicy deflate = {}) : ws_(ioc_), deflate_(deflate) {}
+
+    ~BeastTransport() override { close(); }
+
+    const char *name() const override { return "beast"; }
+
+    bool connect(const std::string &host, int port, const std::string &path) override {
+        using tcp = boost::asio::ip::tcp;
+        boost::beast::error_code ec;
+        tcp::resolver resolver(ioc_);
+        auto results = resolver.resolve(host, std::to_string(port), ec);
+        if (ec) return false;
+        boost::asio::connect(ws_.next_layer(), results, ec);
+        if (ec) return false;
+        ws_.next_layer().set_option(tcp::no_delay(true));
+        // CDP messages routinely exceed Beast's default limits.
+        ws_.read_message_max(512 * 1024 * 1024);
+        if (deflate_.negotiate(host)) {
+            boost::beast::websocket::permessage_deflate pmd;
+            pmd.client_enable = true;
+            // Our commands are small; cheap compression is enough for them.
+            pmd.compLevel = 1;
+#if BOOST_VERSION >= 107700
+            pmd.msg_size_threshold = deflate_.min_message_size;
+#endif
+            ws_.set_option(pmd);
+        }
+        ws_.handshake(host + ":" + std::to_string(port), path, ec);
+        if (ec) return false;
+        ws_.text(true);
+        open_ = true;
+        return true;
+    }
+
+    void send(const std::string &text) override {
+        if (!open_) return;
+        boost::beast::error_code ec;
+        ws_.write(boost::asio::buffer(text), ec);
+        if (ec) open_ = false;
+    }
+
+    bool poll(int timeout_ms) override {
+        if (!open_) return false;
+        if (!read_pending_) start_read();
+        ioc_.restart();
+        ioc_.run_for(std::chrono::milliseconds(timeout_ms));
+        return open_;
+    }
+
+    void close() override {
+        if (!ws_.next_layer().is_open()) return;
+        boost::beast::error_code ec;
+        if (open_) ws_.close(boost::beast::websocket::close_code::normal, ec);
+        ws_.next_layer().close(ec);
+        open_ = false;
+    }
+
+private:
+    boost::asio::io_context ioc_;
+    boost::beast::websocket::stream<boost::asio::ip::tcp::socket> ws_;
+    boost::beast::flat_buffer buffer_;
+    DeflatePolicy deflate_;
+    bool read_pending_ = false;
+    bool open_ = false;
+
+    void start_read() {
+        read_pending_ = true;
+        ws_.async_read(buffer_, [this](boost::beast::error_code ec, size_t) {
+            read_pending_ = false;
+            if (ec) {
+                open_ = false;
+                return;
+            }
+            auto data = buffer_.data();
+            deliver(std::string_view(static_cast<const char *>(data.data()), data.size()));
+            buffer_.consume(buffer_.size());
+            start_read();
+        });
+    }
+};
@@ -0,0 +1,135 @@
+// transport_lws.hpp
+
+#pragma once
+#include <string>
+#include <deque>
+#include <vector>
+#include <cstring>
+#include <chrono>
+#include <libwebsockets.h>
+#include "transport.hpp"
+#include "deflatepolicy.hpp"
+
+// libwebsockets backend. One context per transport; the callback finds the
+// transport through the context user pointer. permessage-deflate is offered
+// when the policy allows it for the host.
+class LwsTransport : public CdpTransport {
+public:
+    explicit LwsTransport(size_t rx_buffer_size = 65536, DeflatePolicy deflate = {}) : deflate_(deflate) {
+        protocols_[0] = {"cdp-protocol", &LwsTransport::callback, 0, rx_buffer_size, 0, nullptr, 0};
+        protocols_[1] = {nullptr, nullptr, 0, 0, 0, nullptr, 0};
+    }
+
+    ~LwsTransport() override { close(); }
+
+    const char *name() const override { return "lws"; }
+
+    bool connect(const std::string &host, int port, const std::string &path) override {
+        struct lws_context_creation_info info = {};
+        info.port = CONTEXT_PORT_NO_LISTEN;
+        info.protocols = protocols_;
+        info.user = this;
+        if (deflate_.negotiate(host)) info.extensions = extensions_;
+        context_ = lws_create_context(&info);
+        if (!context_) return false;
+
+        host_ = host;
+        path_ = path;
+        struct lws_client_connect_info ccinfo = {};
+        ccinfo.context = context_;
+        ccinfo.address = host_.c_str();
+        ccinfo.port = port;
+        ccinfo.path = path_.c_str();
+        ccinfo.host = host_.c_str();
+        ccinfo.origin = host_.c_str();
+        ccinfo.protocol = protocols_[0].name;
+        wsi_ = lws_client_connect_via_info(&ccinfo);
+        if (!wsi_) return false;
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!open_ && !closed_ && std::chrono::steady_clock::now() < deadline) lws_service(context_, 50);
+        return open_;
+    }
+
+    void send(const std::string &text) override {
+        std::vector<unsigned char> buf(LWS_PRE + text.size());
+        std::memcpy(buf.data() + LWS_PRE, text.data(), text.size());
+        send_queue_.push_back(std::move(buf));
+        if (wsi_) lws_callback_on_writable(wsi_);
+    }
+
+    bool poll(int timeout_ms) override {
+        if (!context_ || closed_) return false;
+        lws_service(context_, timeout_ms);
+        return !closed_;
+    }
+
+    // Only while the transport is connected; lws_cancel_service() is the one
+    // lws call that is safe off the service thread.
+    void wake() override {
+        if (context_) lws_cancel_service(context_);
+    }
+
+    void close() override {
+        if (context_) lws_context_destroy(context_);
+        context_ = nullptr;
+        wsi_ = nullptr;
+    }
+
+private:
+    static constexpr struct lws_extension extensions_[] = {
+        {"permessage-deflate", lws_extension_callback_pm_deflate, "permessage-deflate; client_max_window_bits"},
+        {nullptr, nullptr, nullptr},
+    };
+
+    struct lws_protocols protocols_[2];
+    DeflatePolicy deflate_;
+    struct lws_context *context_ = nullptr;
+    struct lws *wsi_ = nullptr;
+    std::string host_, path_;
+    std::deque<std::vector<unsigned char>> send_queue_;
+    std::string received_;
+    bool open_ = false;
+    bool closed_ = false;
+
+    static int callback(struct lws *wsi, enum lws_callback_reasons reason, void *, void *in, size_t len) {
+        auto *self = static_cast<LwsTransport *>(lws_context_user(lws_get_context(wsi)));
+        if (!self) return 0;
+
+        switch (reason) {
+            case LWS_CALLBACK_CLIENT_ESTABLISHED:
+                self->open_ = true;
+                if (!self->send_queue_.empty()) lws_callback_on_writable(wsi);
+                break;
+
+            case LWS_CALLBACK_CLIENT_WRITEABLE: {
+                if (self->send_queue_.empty()) break;
+                auto &buf = self->send_queue_.front();
+                size_t n = buf.size() - LWS_PRE;
+                if (lws_write(wsi, buf.data() + LWS_PRE, n, LWS_WRITE_TEXT) < static_cast<int>(n)) return -1;
+                self->send_queue_.pop_front();
+                if (!self->send_queue_.empty()) lws_callback_on_writable(wsi);
+                break;
+            }
+
+            case LWS_CALLBACK_CLIENT_RECEIVE:
+                self->received_.append(static_cast<const char *>(in), len);
+                if (lws_is_final_fragment(wsi)) {
+                    self->deliver(self->received_);
+                    self->received_.clear();
+                }
+                break;
+
+            case LWS_CALLBACK_CLIENT_CONNECTION_ERROR:
+            case LWS_CALLBACK_CLIENT_CLOSED:
+            case LWS_CALLBACK_CLOSED:
+                self->closed_ = true;
+                self->open_ = false;
+                break;
+
+            default:
+                break;
+        }
+        return 0;
+    }
+};
@@ -0,0 +1,213 @@
+// transport_pipe.hpp
+
+#pragma once
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <nlohmann/json.hpp>
+#include "transport.hpp"
+
+// CDP over Chrome's --remote-debugging-pipe: Chrome reads commands from fd 3
+// and writes replies and events to fd 4, each message a JSON text followed
+// by a NUL byte. No /json discovery, no WebSocket handshake or framing.
+//
+// The pipe is connected to the browser target, not a page. Page commands
+// need a session: open_page_session() creates a tab and attaches with
+// flatten, and the caller adds "sessionId" to each command.
+//
+// attach() takes an existing fd pair instead of launching Chrome, so a fake
+// peer on a socketpair or pipe can stand in for the browser (see
+// transportpipetest.cpp).
+//
+// A write to a pipe whose reader has exited raises SIGPIPE, which kills the
+// process by default. The transport leaves signal dispositions alone: a
+// program using it should ignore SIGPIPE in main(), after which such a write
+// fails with EPIPE and the transport reports itself closed.
+class PipeTransport : public CdpTransport {
+public:
+    ~PipeTransport() override { close(); }
+
+    const char *name() const override { return "pipe"; }
+
+    // Start Chrome with the debugging pipe on fds 3/4. extra_args are passed
+    // through (e.g. --headless=new, --user-data-dir=...).
+    bool launch(const std::string &chrome_path, const std::vector<std::string> &extra_args = {}) {
+        int to_chrome[2], from_chrome[2];
+        if (::pipe(to_chrome) != 0) return false;
+        if (::pipe(from_chrome) != 0) {
+            ::close(to_chrome[0]);
+            ::close(to_chrome[1]);
+            return false;
+        }
+
+        pid_t pid = ::fork();
+        if (pid < 0) return false;
+        if (pid == 0) {
+            // Move both ends above 4 first so the dup2s below cannot clobber
+            // each other.
+            int in = ::fcntl(to_chrome[0], F_DUPFD, 10);
+            int out = ::fcntl(from_chrome[1], F_DUPFD, 10);
+            ::dup2(in, 3);
+            ::dup2(out, 4);
+            for (int fd : {to_chrome[0], to_chrome[1], from_chrome[0], from_chrome[1], in, out}) {
+                if (fd > 4) ::close(fd);
+            }
+
+            std::vector<std::string> args = {chrome_path, "--remote-debugging-pipe"};
+            args.insert(args.end(), extra_args.begin(), extra_args.end());
+            std::vector<char *> argv;
+            for (auto &a : args) argv.push_back(a.data());
+            argv.push_back(nullptr);
+            ::execv(chrome_path.c_str(), argv.data());
+            ::_exit(127);
+        }
+
+        ::close(to_chrome[0]);
+        ::close(from_chrome[1]);
+        child_ = pid;
+        return attach(from_chrome[0], to_chrome[1]);
+    }
+
+    // Use an already connected pair: read_fd carries Chrome's output,
+    // write_fd its input. The transport takes ownership of both.
+    bool attach(int read_fd, int write_fd) {
+        read_fd_ = read_fd;
+        write_fd_ = write_fd;
+        ::fcntl(read_fd_, F_SETFD, FD_CLOEXEC);
+        ::fcntl(write_fd_, F_SETFD, FD_CLOEXEC);
+        closed_ = false;
+        return true;
+    }
+
+    // The pipe is already connected once launched or attached.
+    bool connect(const std::string &, int, const std::string &) override { return read_fd_ >= 0 && !closed_; }
+
+    void send(const std::string &text) override {
+        if (write_fd_ < 0) return;
+        // Each message is terminated by NUL; write both in one call.
+        std::string framed;
+        framed.reserve(text.size() + 1);
+        framed.append(text);
+        framed.push_back('\0');
+        const char *p = framed.data();
+        size_t left = framed.size();
+        while (left > 0) {
+            ssize_t n = ::write(write_fd_, p, left);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                closed_ = true;
+                return;
+            }
+            p += n;
+            left -= static_cast<size_t>(n);
+        }
+    }
+
+    bool poll(int timeout_ms) override {
+        if (closed_ || read_fd_ < 0) return false;
+        struct pollfd pfd = {read_fd_, POLLIN, 0};
+        int ready = ::poll(&pfd, 1, timeout_ms);
+        if (ready < 0) return errno == EINTR;
+        if (ready == 0) return true;
+
+        // Drain what is available without blocking again.
+        char chunk[65536];
+        do {
+            ssize_t n = ::read(read_fd_, chunk, sizeof(chunk));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                closed_ = true;
+                break;
+            }
+            split_messages(chunk, static_cast<size_t>(n));
+            pfd.revents = 0;
+        } while (::poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN));
+        return !closed_;
+    }
+
+    void close() override {
+        if (read_fd_ >= 0) ::close(read_fd_);
+        if (write_fd_ >= 0) ::close(write_fd_);
+        read_fd_ = write_fd_ = -1;
+        closed_ = true;
+        if (child_ > 0) {
+            // Chrome exits when its pipe closes; SIGTERM covers a wedged one.
+            ::kill(child_, SIGTERM);
+            ::waitpid(child_, nullptr, 0);
+            child_ = -1;
+        }
+    }
+
+    // Target.createTarget + Target.attachToTarget(flatten) on the browser
+    // connection. Returns the sessionId, or "" on failure. Messages that
+    // arrive meanwhile are still delivered to the handler.
+    std::string open_page_session(const std::string &url = "about:blank", int timeout_ms = 10000) {
+        nlohmann::json create = {{"id", session_command_id_}, {"method", "Target.createTarget"},
+                                 {"params", {{"url", url}}}};
+        nlohmann::json reply = call(create, timeout_ms);
+        std::string target_id = reply["result"].value("targetId", "");
+        if (target_id.empty()) return "";
+
+        nlohmann::json attach = {{"id", session_command_id_}, {"method", "Target.attachToTarget"},
+                                 {"params", {{"targetId", target_id}, {"flatten", true}}}};
+        reply = call(attach, timeout_ms);
+        return reply["result"].value("sessionId", "");
+    }
+
+private:
+    int read_fd_ = -1;
+    int write_fd_ = -1;
+    pid_t child_ = -1;
+    bool closed_ = true;
+    std::string partial_;
+    // Ids for open_page_session, well away from client command ids.
+    int session_command_id_ = 1 << 30;
+
+    void split_messages(const char *data, size_t len) {
+        const char *end = data + len;
+        while (data < end) {
+            const char *nul = static_cast<const char *>(std::memchr(data, '\0', static_cast<size_t>(end - data)));
+            if (!nul) {
+                partial_.append(data, end);
+                return;
+            }
+            if (partial_.empty()) {
+                deliver(std::string_view(data, static_cast<size_t>(nul - data)));
+            } else {
+                partial_.append(data, nul);
+                deliver(partial_);
+                partial_.clear();
+            }
+            data = nul + 1;
+        }
+    }
+
+    nlohmann::json call(const nlohmann::json &command, int timeout_ms) {
+        int id = command["id"];
+        session_command_id_++;
+        nlohmann::json reply = nlohmann::json::object();
+        MessageHandler saved = handler_;
+        handler_ = [&](std::string_view message) {
+            auto j = nlohmann::json::parse(message, nullptr, false);
+            if (!j.is_discarded() && j.value("id", 0) == id) {
+                reply = std::move(j);
+            } else if (saved) {
+                saved(message);
+            }
+        };
+        send(command.dump());
+        for (int waited = 0; reply.empty() && waited < timeout_ms; waited += 50) {
+            if (!poll(50)) break;
+        }
+        handler_ = saved;
+        if (!reply.contains("result")) reply["result"] = nlohmann::json::object();
+        return reply;
+    }
+};
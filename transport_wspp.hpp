@@ -0,0 +1,81 @@
+// transport_wspp.hpp
+
+#pragma once
+#include <string>
+#include <chrono>
+#include <websocketpp/config/asio_no_tls_client.hpp>
+#include <websocketpp/client.hpp>
+#include "transport.hpp"
+
+// websocketpp (Asio) backend, the stack used by Boost. The asio_client config
+// is built without the permessage-deflate extension, so this backend always
+// runs uncompressed.
+class WsppTransport : public CdpTransport {
+public:
+    typedef websocketpp::client<websocketpp::config::asio_client> client;
+
+    WsppTransport() {
+        c_.clear_access_channels(websocketpp::log::alevel::all);
+        c_.clear_error_channels(websocketpp::log::elevel::all);
+        c_.init_asio();
+        c_.set_open_handler([this](websocketpp::connection_hdl hdl) {
+            hdl_ = hdl;
+            open_ = true;
+        });
+        c_.set_message_handler([this](websocketpp::connection_hdl, client::message_ptr msg) {
+            deliver(msg->get_payload());
+        });
+        c_.set_fail_handler([this](websocketpp::connection_hdl) { closed_ = true; });
+        c_.set_close_handler([this](websocketpp::connection_hdl) {
+            closed_ = true;
+            open_ = false;
+        });
+    }
+
+    ~WsppTransport() override { close(); }
+
+    const char *name() const override { return "wspp"; }
+
+    bool connect(const std::string &host, int port, const std::string &path) override {
+        std::string uri = "ws://" + host + ":" + std::to_string(port) + path;
+        websocketpp::lib::error_code ec;
+        client::connection_ptr con = c_.get_connection(uri, ec);
+        if (ec) return false;
+        c_.connect(con);
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!open_ && !closed_ && std::chrono::steady_clock::now() < deadline) c_.run_one();
+        return open_;
+    }
+
+    void send(const std::string &text) override {
+        if (!open_) return;
+        websocketpp::lib::error_code ec;
+        c_.send(hdl_, text, websocketpp::frame::opcode::text, ec);
+        if (ec) closed_ = true;
+    }
+
+    bool poll(int timeout_ms) override {
+        if (closed_) return false;
+        auto &io = c_.get_io_service();
+        io.restart();
+        io.run_for(std::chrono::milliseconds(timeout_ms));
+        return !closed_;
+    }
+
+    void close() override {
+        if (!open_) return;
+        websocketpp::lib::error_code ec;
+        c_.close(hdl_, websocketpp::close::status::normal, "", ec);
+        open_ = false;
+        // Let the close handshake go out.
+        c_.get_io_service().restart();
+        c_.get_io_service().run_for(std::chrono::milliseconds(100));
+    }
+
+private:
+    client c_;
+    websocketpp::connection_hdl hdl_;
+    bool open_ = false;
+    bool closed_ = false;
+};
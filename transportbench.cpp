@@ -0,0 +1,254 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <sys/resource.h>
+#include <nlohmann/json.hpp>
+#include "transport.hpp"
+#include "transport_lws.hpp"
+#include "transport_beast.hpp"
+#include "transport_wspp.hpp"
+#include "transport_pipe.hpp"
+
+// Replays the same CDP command list through each transport backend against a
+// running Chrome (--remote-debugging-port) and reports round-trip latency,
+// pipelined throughput and CPU time per message.
+//
+//   transportbench [--host localhost] [--port 9222] [--backends lws,wspp,beast]
+//                  [--replay commands.jsonl] [--repeat 200] [--window 16]
+//                  [--chrome /usr/bin/google-chrome]
+//
+// The "pipe" backend launches its own headless Chrome (--chrome) with
+// --remote-debugging-pipe instead of connecting to the running one, so its
+// connect time includes browser startup.
+//
+// A replay file holds one {"method": ..., "params": ...} object per line;
+// without one a mix of small evaluates and a full DOM.getDocument is used.
+
+using json = nlohmann::json;
+using steady = std::chrono::steady_clock;
+
+struct Command {
+    std::string method;
+    json params;
+};
+
+struct Result {
+    std::string backend;
+    size_t messages = 0;
+    double connect_ms = 0;
+    double p50_us = 0, p99_us = 0;
+    double msgs_per_sec = 0;
+    double mb_per_sec = 0;
+    double cpu_us_per_msg = 0;
+    bool ok = false;
+};
+
+std::vector<Command> default_workload() {
+    return {
+        {"Runtime.evaluate", {{"expression", "1 + 1"}, {"returnByValue", true}}},
+        {"Runtime.evaluate", {{"expression", "document.title"}, {"returnByValue", true}}},
+        {"Page.getLayoutMetrics", json::object()},
+        {"Runtime.evaluate", {{"expression", "document.documentElement.outerHTML"}, {"returnByValue", true}}},
+        {"DOM.getDocument", {{"depth", -1}, {"pierce", true}}},
+    };
+}
+
+std::vector<Command> load_workload(const std::string &path) {
+    std::vector<Command> commands;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+        json j = json::parse(line, nullptr, false);
+        if (j.is_discarded() || !j.contains("method")) continue;
+        commands.push_back({j["method"], j.value("params", json::object())});
+    }
+    return commands;
+}
+
+std::string build_command(int id, const std::string &method, const json &params = {},
+                          const std::string &session_id = "") {
+    json j;
+    j["id"] = id;
+    j["method"] = method;
+    if (!params.empty()) j["params"] = params;
+    if (!session_id.empty()) j["sessionId"] = session_id;
+    return j.dump();
+}
+
+// Chrome writes responses as {"id":N,...}; events start with "method".
+// Sniffing the prefix keeps JSON parsing out of the measurement.
+int response_id(std::string_view message) {
+    size_t pos = message.substr(0, 32).find("\"id\":");
+    if (pos == std::string_view::npos) return -1;
+    return std::atoi(message.data() + pos + 5);
+}
+
+double cpu_seconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+std::unique_ptr<CdpTransport> make_transport(const std::string &name) {
+    if (name == "lws") return std::make_unique<LwsTransport>(1 << 20);
+    if (name == "wspp") return std::make_unique<WsppTransport>();
+    if (name == "beast") return std::make_unique<BeastTransport>();
+    if (name == "pipe") return std::make_unique<PipeTransport>();
+    return nullptr;
+}
+
+Result run_backend(const std::string &backend, const std::string &host, int port, const std::string &chrome,
+                   const std::vector<Command> &workload, int repeat, int window) {
+    Result result;
+    result.backend = backend;
+    auto transport = make_transport(backend);
+    if (!transport) {
+        std::cerr << "Unknown backend: " << backend << std::endl;
+        return result;
+    }
+
+    auto connect_start = steady::now();
+    std::string session_id;
+    if (auto *pipe = dynamic_cast<PipeTransport *>(transport.get())) {
+        if (pipe->launch(chrome, {"--headless=new", "--no-first-run", "--user-data-dir=/tmp/transportbench-profile"})) {
+            session_id = pipe->open_page_session();
+        }
+        if (session_id.empty()) {
+            std::cerr << backend << ": could not start " << chrome << std::endl;
+            return result;
+        }
+    } else {
+        std::string path = discover_page_path(host, port);
+        if (path.empty() || !transport->connect(host, port, path)) {
+            std::cerr << backend << ": connect failed" << std::endl;
+            return result;
+        }
+    }
+    result.connect_ms = std::chrono::duration<double, std::milli>(steady::now() - connect_start).count();
+
+    int next_id = 1;
+    int last_response = 0;
+    size_t bytes_received = 0;
+    transport->on_message([&](std::string_view message) {
+        bytes_received += message.size();
+        int id = response_id(message);
+        if (id > 0) last_response = id;
+    });
+
+    auto wait_for = [&](int id) {
+        while (last_response < id) {
+            if (!transport->poll(100)) return false;
+        }
+        return true;
+    };
+
+    // Warm up: connection buffers, Chrome's own caches.
+    for (const auto &cmd : workload) {
+        int id = next_id++;
+        transport->send(build_command(id, cmd.method, cmd.params, session_id));
+        if (!wait_for(id)) return result;
+    }
+
+    double cpu_start = cpu_seconds();
+
+    // Latency: one command in flight at a time.
+    std::vector<double> latencies;
+    for (int r = 0; r < repeat; r++) {
+        for (const auto &cmd : workload) {
+            int id = next_id++;
+            auto start = steady::now();
+            transport->send(build_command(id, cmd.method, cmd.params, session_id));
+            if (!wait_for(id)) return result;
+            latencies.push_back(std::chrono::duration<double, std::micro>(steady::now() - start).count());
+        }
+    }
+
+    // Throughput: keep `window` commands in flight. Chrome answers a session's
+    // commands in order, so the highest id seen bounds the outstanding count.
+    size_t total = workload.size() * static_cast<size_t>(repeat);
+    int first_id = next_id;
+    bytes_received = 0;
+    auto start = steady::now();
+    for (size_t i = 0; i < total; i++) {
+        const auto &cmd = workload[i % workload.size()];
+        transport->send(build_command(next_id++, cmd.method, cmd.params, session_id));
+        while (next_id - 1 - last_response >= window) {
+            if (!transport->poll(100)) return result;
+        }
+    }
+    if (!wait_for(next_id - 1)) return result;
+    double seconds = std::chrono::duration<double>(steady::now() - start).count();
+
+    double cpu = cpu_seconds() - cpu_start;
+    transport->close();
+
+    std::sort(latencies.begin(), latencies.end());
+    result.messages = latencies.size() + static_cast<size_t>(next_id - first_id);
+    result.p50_us = latencies[latencies.size() / 2];
+    result.p99_us = latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+    result.msgs_per_sec = total / seconds;
+    result.mb_per_sec = bytes_received / seconds / (1024.0 * 1024.0);
+    result.cpu_us_per_msg = cpu * 1e6 / result.messages;
+    result.ok = true;
+    return result;
+}
+
+int main(int argc, char **argv) {
+    std::string host = "localhost";
+    int port = 9222;
+    std::string backends = "lws,wspp,beast";
+    std::string replay;
+    int repeat = 200;
+    int window = 16;
+    std::string chrome = "/usr/bin/google-chrome";
+    // The pipe backend's Chrome may exit first; see transport_pipe.hpp.
+    std::signal(SIGPIPE, SIG_IGN);
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--host" && i + 1 < argc) host = argv[++i];
+        else if (arg == "--port" && i + 1 < argc) port = std::atoi(argv[++i]);
+        else if (arg == "--backends" && i + 1 < argc) backends = argv[++i];
+        else if (arg == "--replay" && i + 1 < argc) replay = argv[++i];
+        else if (arg == "--repeat" && i + 1 < argc) repeat = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--window" && i + 1 < argc) window = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--chrome" && i + 1 < argc) chrome = argv[++i];
+    }
+
+    std::vector<Command> workload = replay.empty() ? default_workload() : load_workload(replay);
+    if (workload.empty()) {
+        std::cerr << "Empty workload" << std::endl;
+        return 1;
+    }
+
+    std::vector<Result> results;
+    size_t start = 0;
+    while (start <= backends.size()) {
+        size_t comma = backends.find(',', start);
+        std::string name = backends.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+        if (!name.empty()) results.push_back(run_backend(name, host, port, chrome, workload, repeat, window));
+        if (comma == std::string::npos) break;
+        start = comma + 1;
+    }
+
+    std::printf("%-8s %12s %10s %10s %10s %10s %10s %12s\n", "backend", "connect(ms)", "messages", "p50(us)",
+                "p99(us)", "msg/s", "MB/s", "cpu(us/msg)");
+    for (const auto &r : results) {
+        if (!r.ok) {
+            std::printf("%-8s %10s\n", r.backend.c_str(), "failed");
+            continue;
+        }
+        std::printf("%-8s %12.1f %10zu %10.0f %10.0f %10.0f %10.1f %12.1f\n", r.backend.c_str(), r.connect_ms,
+                    r.messages, r.p50_us, r.p99_us, r.msgs_per_sec, r.mb_per_sec, r.cpu_us_per_msg);
+    }
+    return 0;
+}
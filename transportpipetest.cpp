@@ -0,0 +1,152 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <functional>
+#include <csignal>
+#include <cstring>
+#include <unistd.h>
+#include "transport_pipe.hpp"
+
+// Checks PipeTransport against a fake browser on a pair of pipes, the way
+// Chrome's --remote-debugging-pipe fds 3/4 are wired, so no Chrome is needed.
+//
+//   transportpipetest
+//
+// Covers a message split across reads, a message larger than the 64 KiB read
+// chunk, the NUL framing send() puts on the wire, and poll() turning false
+// once the peer closes. Prints one line per case; exits non-zero on failure.
+
+struct FakePeer {
+    int to_transport[2] = {-1, -1};    // peer writes [1], transport reads [0]
+    int from_transport[2] = {-1, -1};  // transport writes [1], peer reads [0]
+
+    bool open(PipeTransport &transport) {
+        if (::pipe(to_transport) != 0 || ::pipe(from_transport) != 0) return false;
+        return transport.attach(to_transport[0], from_transport[1]);
+    }
+
+    ~FakePeer() {
+        for (int fd : {to_transport[1], from_transport[0]}) {
+            if (fd >= 0) ::close(fd);
+        }
+    }
+
+    void write_all(const std::string &data) {
+        const char *p = data.data();
+        size_t left = data.size();
+        while (left > 0) {
+            ssize_t n = ::write(to_transport[1], p, left);
+            if (n <= 0) return;
+            p += n;
+            left -= static_cast<size_t>(n);
+        }
+    }
+
+    std::string read_exactly(size_t size) {
+        std::string out(size, '\0');
+        size_t got = 0;
+        while (got < size) {
+            ssize_t n = ::read(from_transport[0], &out[got], size - got);
+            if (n <= 0) break;
+            got += static_cast<size_t>(n);
+        }
+        out.resize(got);
+        return out;
+    }
+
+    void close_write() {
+        ::close(to_transport[1]);
+        to_transport[1] = -1;
+    }
+};
+
+static int failures = 0;
+
+static void check(const char *name, bool ok, const std::string &detail = "") {
+    std::cout << (ok ? "ok   " : "FAIL ") << name;
+    if (!ok && !detail.empty()) std::cout << ": " << detail;
+    std::cout << "\n";
+    if (!ok) failures++;
+}
+
+// Polls until count messages arrived, the transport closed or ~2 s passed.
+static bool poll_for(PipeTransport &transport, const std::vector<std::string> &received, size_t count) {
+    for (int i = 0; i < 200 && received.size() < count; i++) {
+        if (!transport.poll(10)) break;
+    }
+    return received.size() >= count;
+}
+
+static void split_message() {
+    PipeTransport transport;
+    FakePeer peer;
+    std::vector<std::string> received;
+    transport.on_message([&](std::string_view m) { received.emplace_back(m); });
+    if (!peer.open(transport)) return check("split message", false, "pipe() failed");
+
+    std::string message = R"({"id":1,"result":{"value":"split across two reads"}})";
+    peer.write_all(message.substr(0, 20));
+    transport.poll(50);
+    bool none_early = received.empty();
+    peer.write_all(message.substr(20) + '\0' + R"({"method":"Page.loadEventFired"})" + '\0');
+    poll_for(transport, received, 2);
+    check("split message", none_early && received.size() == 2 && received[0] == message &&
+                               received[1] == R"({"method":"Page.loadEventFired"})",
+          std::to_string(received.size()) + " messages");
+}
+
+static void large_message() {
+    PipeTransport transport;
+    FakePeer peer;
+    std::vector<std::string> received;
+    transport.on_message([&](std::string_view m) { received.emplace_back(m); });
+    if (!peer.open(transport)) return check("message over 64 KiB", false, "pipe() failed");
+
+    std::string message = R"({"id":2,"result":{"data":")" + std::string(300 * 1024, 'x') + R"("}})";
+    // Larger than the pipe buffer: the writer blocks until the transport reads.
+    std::thread writer([&] { peer.write_all(message + '\0'); });
+    poll_for(transport, received, 1);
+    writer.join();
+    check("message over 64 KiB", received.size() == 1 && received[0] == message,
+          received.empty() ? "nothing delivered" : std::to_string(received[0].size()) + " bytes");
+}
+
+static void send_framing() {
+    PipeTransport transport;
+    FakePeer peer;
+    if (!peer.open(transport)) return check("NUL framing on send", false, "pipe() failed");
+
+    std::string a = R"({"id":1,"method":"Browser.getVersion"})";
+    std::string b = R"({"id":2,"method":"Target.getTargets"})";
+    transport.send(a);
+    transport.send(b);
+    std::string wire = peer.read_exactly(a.size() + b.size() + 2);
+    check("NUL framing on send", wire == a + '\0' + b + '\0', "got " + std::to_string(wire.size()) + " bytes");
+}
+
+static void peer_closes() {
+    PipeTransport transport;
+    FakePeer peer;
+    std::vector<std::string> received;
+    transport.on_message([&](std::string_view m) { received.emplace_back(m); });
+    if (!peer.open(transport)) return check("poll false after peer closes", false, "pipe() failed");
+
+    bool open_before = transport.poll(10);
+    peer.write_all(std::string(R"({"method":"Inspector.detached"})") + '\0');
+    peer.close_write();
+    bool closed = false;
+    for (int i = 0; i < 200 && !closed; i++) closed = !transport.poll(10);
+    check("poll false after peer closes", open_before && closed && received.size() == 1 && !transport.poll(0));
+}
+
+int main() {
+    // A send after the peer is gone must fail with EPIPE, not end the test.
+    std::signal(SIGPIPE, SIG_IGN);
+    split_message();
+    large_message();
+    send_framing();
+    peer_closes();
+    std::cout << (failures ? "FAILED" : "all passed") << "\n";
+    return failures ? 1 : 0;
+}
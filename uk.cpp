@@ -11,6 +11,10 @@
 #include <algorithm>
 #include <cctype>
 #include <cassert>
+#include <any>
+#include <nlohmann/json.hpp>
+#include "directclick.hpp"
+#include "steppipeline.hpp"
 
 // Simulate a Page class
 class Page
@@ -105,6 +109,82 @@ public:
 
 
 
+// CDP form of the actions a step can pipeline (see steppipeline.hpp).
+// backend_node_for_index maps a selector-map index to its backendNodeId.
+// Returns nullopt for actions that still have to go through the controller.
+std::optional<PipelinedAction> pipelined_action(const std::string &name,
+                                                const std::map<std::string, std::any> &params,
+                                                const std::function<int(int)> &backend_node_for_index)
+{
+    using nlohmann::json;
+    auto param = [&](const char *key, auto fallback) -> decltype(fallback) {
+        auto it = params.find(key);
+        if (it == params.end() || it->second.type() != typeid(fallback))
+            return fallback;
+        return std::any_cast<decltype(fallback)>(it->second);
+    };
+    auto command = [](const char *method, json args) { return json{{"method", method}, {"params", std::move(args)}}; };
+
+    if (name == "click_element")
+    {
+        int backend = backend_node_for_index(param("index", -1));
+        if (backend <= 0)
+            return std::nullopt;
+        auto click = std::make_shared<DirectClick>(DirectClick::backend_node(backend));
+        return PipelinedAction{name, [click](const json &results)
+                               { return results.is_null() ? click->start() : click->next(results); },
+                               true};
+    }
+    if (name == "input_text")
+    {
+        int backend = backend_node_for_index(param("index", -1));
+        if (backend <= 0)
+            return std::nullopt;
+        return PipelinedAction::fixed(name, json::array({command("DOM.focus", {{"backendNodeId", backend}}),
+                                                         command("Input.insertText", {{"text", param("text", std::string())}})}));
+    }
+    if (name == "scroll_down" || name == "scroll_up")
+    {
+        int amount = param("amount", 0);
+        std::string delta = amount > 0 ? std::to_string(amount) : "window.innerHeight";
+        if (name == "scroll_up")
+            delta = "-" + delta;
+        return PipelinedAction::fixed(name, json::array({command("Runtime.evaluate", {{"expression", "window.scrollBy(0, " + delta + ");"}})}));
+    }
+    if (name == "send_keys")
+    {
+        std::string key = param("keys", std::string());
+        json down = {{"type", "keyDown"}, {"key", key}};
+        json up = {{"type", "keyUp"}, {"key", key}};
+        if (key == "Enter")
+            down["text"] = "\r";
+        return PipelinedAction::fixed(name, json::array({command("Input.dispatchKeyEvent", down), command("Input.dispatchKeyEvent", up)}),
+                                      key == "Enter");
+    }
+    if (name == "go_to_url")
+        return PipelinedAction::fixed(name, json::array({command("Page.navigate", {{"url", param("url", std::string())}})}), true);
+    return std::nullopt;
+}
+
+// The longest prefix of a step's actions that can run as one pipeline; the
+// controller runs the rest one at a time as before.
+std::vector<PipelinedAction> pipelined_step(const std::vector<ActionModel> &step,
+                                            const std::function<int(int)> &backend_node_for_index)
+{
+    std::vector<PipelinedAction> out;
+    for (const auto &model : step)
+    {
+        for (const auto &[name, params] : model.actions)
+        {
+            auto action = pipelined_action(name, params, backend_node_for_index);
+            if (!action)
+                return out;
+            out.push_back(std::move(*action));
+        }
+    }
+    return out;
+}
+
 // ActionRegistry definition
 class ActionRegistry
 {
@@ -244,6 +324,40 @@ int main()
     empty_model.set_index(10); // Should have no effect
     empty_model.print_index(); // Still: Index not set.
 
+    std::cout << "\n=== Testing Step Pipelining ===" << std::endl;
+
+    // Type, click, then scroll: the click is a fence, so the scroll waits for
+    // the click's replies and is dropped once the click navigates.
+    std::vector<ActionModel> step(3);
+    step[0].actions["input_text"] = {{"index", 1}, {"text", std::string("lofi beats")}};
+    step[1].actions["click_element"] = {{"index", 2}};
+    step[2].actions["scroll_down"] = {};
+    StepPipeline pipeline(pipelined_step(step, [](int index) { return 100 + index; }));
+
+    int next_id = 1;
+    std::vector<nlohmann::json> sent;
+    for (auto &cmd : pipeline.start(next_id))
+        sent.push_back(cmd);
+    std::cout << "First batch: " << sent.size() << " commands" << std::endl; // focus, insertText, scrollIntoViewIfNeeded, getContentQuads
+    while (!sent.empty())
+    {
+        std::vector<nlohmann::json> more;
+        for (const auto &cmd : sent)
+        {
+            nlohmann::json result = nlohmann::json::object();
+            if (cmd["method"] == "DOM.getContentQuads")
+                result["quads"] = {{10, 10, 90, 10, 90, 30, 10, 30}};
+            if (cmd["params"].value("type", "") == "mouseReleased")
+                pipeline.on_event({{"method", "Page.frameNavigated"}, {"params", {{"frame", {{"id", "main"}, {"url", "https://www.example.com/results"}}}}}});
+            for (auto &next : pipeline.on_reply({{"id", cmd["id"]}, {"result", result}}, next_id))
+                more.push_back(next);
+        }
+        sent = std::move(more);
+    }
+    std::cout << "Completed " << pipeline.completed() << "/" << pipeline.size() << " in "
+              << pipeline.round_trips() << " round trips; stopped: " << pipeline.abort_reason() << std::endl;
+    assert(pipeline.finished() && pipeline.completed() == 2);
+
     std::cout << "\n=== All Tests Completed Successfully ===" << std::endl;
 
     return 0;